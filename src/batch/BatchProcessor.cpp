@@ -0,0 +1,201 @@
+#include "BatchProcessor.h"
+
+#include "../dsp/DecodePipeline.h"
+#include "../dsp/SampleFile.h"
+#include "../tracking/FrameDeduplicator.h"
+#include "../tracking/SensorTracker.h"
+#include "../output/EventWriter.h"
+
+#include <glob.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+
+BatchProcessor::BatchProcessor(const std::string& input, const bool& cs8, std::ostream& out, const unsigned int& num_threads) :
+		paths(expand(input)), cs8(cs8), out(out), results(paths.size()), pool(num_threads) {
+	if (paths.empty()) {
+		throw NO_INPUT_FILES;
+	}
+}
+
+
+/*
+ * Lists the regular files in a directory and its subdirectories, or matching a glob pattern, sorted by path
+ */
+std::vector<std::string> BatchProcessor::expand(const std::string& input) {
+	std::vector<std::string> paths;
+	std::error_code error;
+	if (std::filesystem::is_directory(input, error)) {
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error)) {
+			if (entry.is_regular_file(error)) {
+				paths.push_back(entry.path().string());
+			}
+		}
+	} else {
+		glob_t matches;
+		if (!glob(input.c_str(), 0, nullptr, &matches)) {
+			for (size_t i = 0; i < matches.gl_pathc; i++) {
+				if (std::filesystem::is_regular_file(matches.gl_pathv[i], error)) {
+					paths.push_back(matches.gl_pathv[i]);
+				}
+			}
+		}
+		globfree(&matches);
+	}
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+
+void BatchProcessor::run() {
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < paths.size(); i++) {
+		pool.submit([this, i] {
+			results[i] = process(paths[i]);
+
+			std::lock_guard<std::mutex> lock(out_mutex);
+			writeFile(paths[i], results[i]);
+		});
+	}
+	pool.wait();
+
+	std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start;
+	writeSummary(wall_time.count());
+}
+
+
+BatchFileResult BatchProcessor::process(const std::string& path) const {
+	BatchFileResult result;
+	std::ifstream input_file(path, std::ios::in | std::ios::binary);
+	if (!input_file) {
+		return result;
+	}
+	result.opened = true;
+
+	auto start = std::chrono::steady_clock::now();
+	DecodePipeline pipeline;	// Without a sink, CRC failures and unknown channels are only counted
+	FrameDeduplicator frame_dedup;
+	SensorTracker sensor_tracker(nullptr, nullptr, BATCH_EXPECTED_SENSORS);
+
+	std::complex<float> buff[BATCH_BLOCK_SIZE];
+	while (size_t num_samples = readSamples(input_file, cs8, buff)) {
+		pipeline.push(buff, num_samples, [&](std::shared_ptr<SensorMessage> sensor_message) {
+			result.frames++;
+			auto event_message = frame_dedup.push(sensor_message);
+			if (event_message) {
+				sensor_tracker.push(std::move(event_message));
+			} else {
+				sensor_tracker.confirm(sensor_message->getTXID());
+			}
+		});
+		result.samples += num_samples;
+	}
+
+	const auto& receiver_stats = pipeline.getReceiverStats();
+	for (unsigned int vendor = 0; vendor < NUM_VENDORS; vendor++) {
+		result.crc_pass += receiver_stats.crc_pass[vendor].get();
+		result.crc_fail += receiver_stats.crc_fail[vendor].get();
+	}
+	result.tracker = sensor_tracker.snapshot(time(NULL));
+	std::sort(result.tracker->sensors.begin(), result.tracker->sensors.end(),
+			[](const SensorSnapshot& a, const SensorSnapshot& b) {return a.txid < b.txid;});
+
+	std::chrono::duration<double> processing_time = std::chrono::steady_clock::now() - start;
+	result.processing_time = processing_time.count();
+
+	return result;
+}
+
+
+static std::ostream& printPath(std::ostream& out, const std::string& path) {	// As a JSON string
+	out << "\"";
+	for (auto c : path) {
+		if ((c == '"') || (c == '\\')) {
+			out << '\\' << c;
+		} else if ((unsigned char)c < 0x20) {
+			out << "\\u00" << "0123456789abcdef"[c>>4] << "0123456789abcdef"[c & 0xF];
+		} else {
+			out << c;
+		}
+	}
+
+	return out << "\"";
+}
+
+
+static std::ostream& printSensor(std::ostream& out, const SensorSnapshot& sensor) {
+	out << "{\"txid\":" << sensor.txid << ",\"txid_str\":\"";
+	printTXID(out, sensor.vendor, sensor.txid) << "\",\"vendor\":\"" << vendorName(sensor.vendor) << "\",\"state\":" << (unsigned int)sensor.sensor_state
+			<< ",\"count\":" << sensor.rx_msg_count;
+
+	return out;
+}
+
+
+void BatchProcessor::writeFile(const std::string& path, const BatchFileResult& result) {
+	out << "{\"event\":\"batch_file\",\"file\":";
+	printPath(out, path);
+	if (!result.opened) {
+		out << ",\"error\":\"could not be opened\"}" << std::endl;
+		return;
+	}
+
+	out << ",\"duration\":" << result.samples/SAMP_RATE << ",\"processing_time\":" << result.processing_time << ",\"frames\":" << result.frames
+			<< ",\"crc_pass\":" << result.crc_pass << ",\"crc_fail\":" << result.crc_fail << ",\"messages\":" << result.tracker->counters.messages
+			<< ",\"changes\":" << result.tracker->counters.changes << ",\"sensors\":[";
+	for (size_t i = 0; i < result.tracker->sensors.size(); i++) {
+		printSensor(out << (i ? "," : ""), result.tracker->sensors[i]) << "}";
+	}
+	out << "]}" << std::endl;
+}
+
+
+void BatchProcessor::writeSummary(const double& wall_time) {
+	struct MergedSensor {
+		SensorSnapshot sensor;
+		unsigned int files;
+	};
+	std::map<unsigned long int, MergedSensor> sensors;	// Sorted for output
+
+	BatchFileResult total;
+	unsigned long long int failed = 0, messages = 0, changes = 0;
+	for (const auto& result : results) {	// In path order, so later files give the final state
+		if (!result.opened) {
+			failed++;
+			continue;
+		}
+
+		total.samples += result.samples;
+		total.frames += result.frames;
+		total.crc_pass += result.crc_pass;
+		total.crc_fail += result.crc_fail;
+		total.processing_time += result.processing_time;
+		messages += result.tracker->counters.messages;
+		changes += result.tracker->counters.changes;
+		for (const auto& sensor : result.tracker->sensors) {
+			auto merged = sensors.try_emplace(sensor.txid, MergedSensor {sensor, 0});
+			if (!merged.second) {
+				merged.first->second.sensor.rx_msg_count += sensor.rx_msg_count;
+				merged.first->second.sensor.sensor_state = sensor.sensor_state;
+			}
+			merged.first->second.files++;
+		}
+	}
+
+	out << "{\"event\":\"batch_summary\",\"files\":" << results.size() << ",\"failed\":" << failed << ",\"threads\":" << pool.size()
+			<< ",\"duration\":" << total.samples/SAMP_RATE << ",\"processing_time\":" << total.processing_time << ",\"wall_time\":" << wall_time
+			<< ",\"realtime_factor\":" << (wall_time > 0 ? total.samples/SAMP_RATE/wall_time : 0) << ",\"frames\":" << total.frames
+			<< ",\"crc_pass\":" << total.crc_pass << ",\"crc_fail\":" << total.crc_fail << ",\"messages\":" << messages << ",\"changes\":" << changes
+			<< ",\"sensors\":[";
+	bool first = true;
+	for (const auto& merged : sensors) {
+		printSensor(out << (first ? "" : ","), merged.second.sensor) << ",\"files\":" << merged.second.files << "}";
+		first = false;
+	}
+	out << "]}" << std::endl;
+}
@@ -0,0 +1,60 @@
+#ifndef SRC_BATCHPROCESSOR_H_
+#define SRC_BATCHPROCESSOR_H_
+
+
+#include "../tracking/TrackerSnapshot.h"
+#include "../util/WorkStealingPool.h"
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define BATCH_BLOCK_SIZE 4096	// Samples read from a file at a time
+#define BATCH_EXPECTED_SENSORS 64	// Initial tracker capacity for each file, captures are short
+
+
+enum BatchError {NO_INPUT_FILES};
+
+
+/*
+ * Decode results of one capture file
+ */
+struct BatchFileResult {
+	bool opened {false};
+	unsigned long long int samples {};
+	unsigned long long int frames {};	// Decoded, before deduplication
+	unsigned long long int crc_pass {};
+	unsigned long long int crc_fail {};
+	double processing_time {};	// Seconds
+	std::unique_ptr<TrackerSnapshot> tracker;
+};
+
+
+/*
+ * Decodes many capture files in parallel, each with its own pipeline, deduplicator and tracker, on a
+ * work-stealing pool so that long files don't hold up the rest. A JSON line of tracker results is
+ * written for each file as it finishes, followed by one merging all files, in which sensors take the
+ * state they had in the last file (by path) that heard them.
+ */
+class BatchProcessor {
+public:
+	BatchProcessor(const std::string& input, const bool& cs8, std::ostream& out, const unsigned int& num_threads);	// Directory or glob pattern
+	void run();
+	size_t size() const {return paths.size();};
+private:
+	static std::vector<std::string> expand(const std::string& input);
+	BatchFileResult process(const std::string& path) const;
+	void writeFile(const std::string& path, const BatchFileResult& result);
+	void writeSummary(const double& wall_time);
+	const std::vector<std::string> paths;	// Sorted
+	const bool cs8;
+	std::ostream& out;
+	std::mutex out_mutex;	// Files finish on any worker
+	std::vector<BatchFileResult> results;	// By path index
+	WorkStealingPool pool;	// Last, so workers are joined before the results they write are destroyed
+};
+
+
+#endif /* SRC_BATCHPROCESSOR_H_ */
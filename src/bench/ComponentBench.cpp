@@ -0,0 +1,359 @@
+#include "../dsp/DecodePipeline.h"
+#include "../dsp/FrameSynthesizer.h"
+#include "../messaging/ManchesterDecoder.h"
+#include "../tracking/SensorTracker.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+#define BENCH_REPEATS 5	// Each benchmark reports its fastest run, to filter out scheduling noise
+#define BENCH_SENSORS 1000	// Distinct sensors in the synthetic traffic
+#define BENCH_FRAMES 64	// Distinct frames in the synthetic signal
+#define FANOUT_CHECK_SNRS {6.0f, 10.0f, 20.0f, INFINITY}	// dB, of the signals the decoder fanout is checked on, INFINITY for a noiseless one
+#define FANOUT_IDLE_SAMPLES 2500000	// 10 s of idle air at SAMP_RATE, with the noise of each checked signal
+#define FANOUT_IDLE_MAX_FED 1.0	// Percent of the samples of idle air an added receiver may be fed, in replays of false sync sequences
+
+
+struct BenchResult {
+	std::string name;
+	double value;
+	std::string unit;
+};
+
+
+template <typename FUNC>
+double nsPerOp(const size_t& ops, FUNC func) {
+	double best = 0;
+	for (unsigned int i = 0; i < BENCH_REPEATS; i++) {
+		auto start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		best = i ? std::min(best, elapsed.count()) : elapsed.count();
+	}
+
+	return best/ops;
+}
+
+
+static SyntheticFrame benchFrame(const unsigned int& i) {
+	static const Vendor vendors[] = {HONEYWELL, TWOGIG, VIVINT_INIT};
+	SyntheticFrame frame {vendors[i%3], 100000ul + (i%BENCH_SENSORS)*37, (unsigned char)((i/BENCH_SENSORS) & 0x1 ? 0x80 : 0x00), 0xABC, 0x18};
+	frame.txid |= (frame.vendor == VIVINT_INIT) ? (0x123ul<<STD_TXID_BITS) : 0;
+	return frame;
+}
+
+
+/*
+ * Square wave at the receiver input rate, as the filter chain would produce from a clean signal
+ */
+static std::vector<bool> receiverLevels(const std::vector<bool>& levels) {
+	const double samples_per_level = PULSE_WIDTH*(SAMP_RATE/(IF_FILT_DECIMATION*BB_DC_FILT_DECIMATION*BB_LP_FILT_DECIMATION));
+	std::vector<bool> square_wave;
+	double level_end = 0;
+	for (auto level : levels) {
+		level_end += samples_per_level;
+		while ((long int)square_wave.size() < std::lround(level_end)) {
+			square_wave.push_back(level);
+		}
+	}
+	square_wave.insert(square_wave.end(), 200, false);	// Gap between frames
+
+	return square_wave;
+}
+
+
+static std::vector<BenchResult> runBenchmarks() {
+	std::vector<BenchResult> results;
+	volatile float sink = 0;
+
+	// Synthetic signal of BENCH_FRAMES frames, sent once each
+	FrameSynthesizer synthesizer;
+	for (unsigned int i = 0; i < BENCH_FRAMES; i++) {
+		synthesizer.addFrame(benchFrame(i), 1);
+	}
+	const auto& signal = synthesizer.render();
+
+	std::vector<float> power(signal.size());
+	for (size_t i = 0; i < signal.size(); i++) {
+		power[i] = std::norm(signal[i]);
+	}
+
+	// Filters, each fed at the full sample rate so their costs compare per input sample
+	results.push_back(BenchResult {"if_filter", nsPerOp(signal.size(), [&] {
+		Filter<std::complex<float>> filter(LPF, SAMP_RATE, IF_FILT_DECIMATION, SENSOR_BW/2, IF_FILT_TRANSITION, FILT_ATTENUATION, TUNE_FREQ_OFFSET);
+		for (const auto& sample : signal) {
+			auto output = filter.compute(sample);
+			if (output) {
+				sink += output->real();
+			}
+		}
+	}), "ns/sample"});
+
+	results.push_back(BenchResult {"bb_dc_filter", nsPerOp(power.size(), [&] {
+		Filter<float> filter(HPF, SAMP_RATE/IF_FILT_DECIMATION, BB_DC_FILT_DECIMATION, BB_DC_FILT_CUTOFF, BB_DC_FILT_TRANSITION, FILT_ATTENUATION);
+		for (const auto& sample : power) {
+			auto output = filter.compute(sample);
+			if (output) {
+				sink += *output;
+			}
+		}
+	}), "ns/sample"});
+
+	results.push_back(BenchResult {"bb_lp_filter", nsPerOp(power.size(), [&] {
+		Filter<float> filter(LPF, SAMP_RATE/(IF_FILT_DECIMATION*BB_DC_FILT_DECIMATION), BB_LP_FILT_DECIMATION, BB_LP_FILT_CUTOFF, BB_LP_FILT_TRANSITION, FILT_ATTENUATION);
+		for (const auto& sample : power) {
+			auto output = filter.compute(sample);
+			if (output) {
+				sink += *output;
+			}
+		}
+	}), "ns/sample"});
+
+	results.push_back(BenchResult {"signal_generator", nsPerOp(signal.size(), [&] {
+		SignalGenerator<std::complex<float>> generator(SAMP_RATE, TUNE_FREQ_OFFSET);
+		for (size_t i = 0; i < signal.size(); i++) {
+			sink += generator.sample().real();
+		}
+	}), "ns/sample"});
+
+	// Frame level components
+	std::vector<SyntheticFrame> frames;
+	for (unsigned int i = 0; i < 2*BENCH_SENSORS; i++) {
+		frames.push_back(benchFrame(i));
+	}
+
+	results.push_back(BenchResult {"crc16", nsPerOp(frames.size(), [&] {
+		CRC16 crc16;
+		for (const auto& frame : frames) {
+			crc16.reset();
+			crc16.setPoly(0x8005);
+			crc16.push(8, CHANNEL_BITS);
+			crc16.push(frame.txid & STD_TXID_MASK, STD_TXID_BITS);
+			crc16.push(frame.sensor_state, SENSOR_STATE_BITS);
+			sink += crc16.getCRC();
+		}
+	}), "ns/frame"});
+
+	std::vector<bool> manchester_levels;
+	for (unsigned int i = 0; i < BENCH_FRAMES; i++) {
+		auto levels = FrameSynthesizer::encode(benchFrame(i));
+		manchester_levels.insert(manchester_levels.end(), levels.begin()+32, levels.end());	// Skip the raw sync levels
+	}
+
+	results.push_back(BenchResult {"manchester_decoder", nsPerOp(manchester_levels.size(), [&] {
+		ManchesterDecoder decoder;
+		for (auto level : manchester_levels) {
+			decoder.add(level);
+			if (decoder.size() == 16) {
+				sink += decoder.pop_all();
+			}
+		}
+	}), "ns/symbol"});
+
+	// Receiver on the square wave of every frame, also collects the messages for the tracker benchmark
+	std::vector<bool> square_wave;
+	for (const auto& frame : frames) {
+		auto frame_wave = receiverLevels(FrameSynthesizer::encode(frame));
+		square_wave.insert(square_wave.end(), frame_wave.begin(), frame_wave.end());
+	}
+	square_wave.push_back(true);	// Symbols are processed on the following transition, including the last CRC symbol
+
+	std::vector<std::shared_ptr<SensorMessage>> messages;
+	results.push_back(BenchResult {"sensor_message_receiver", nsPerOp(square_wave.size(), [&] {
+		SensorMessageReceiver receiver(PULSE_WIDTH*(SAMP_RATE/(IF_FILT_DECIMATION*BB_DC_FILT_DECIMATION*BB_LP_FILT_DECIMATION)));
+		messages.clear();
+		for (auto level : square_wave) {
+			auto message = receiver.push(level);
+			if (message) {
+				messages.push_back(message);
+			}
+		}
+	}), "ns/sample"});
+	results.push_back(BenchResult {"sensor_message_receiver_frames", (double)messages.size(), "frames"});
+
+	results.push_back(BenchResult {"sensor_tracker", nsPerOp(messages.size(), [&] {
+		SensorTracker tracker;
+		for (const auto& message : messages) {
+			tracker.push(message);
+		}
+	}), "ns/message"});
+
+	// Full decode chain on the synthetic signal
+	unsigned int pipeline_frames = 0;
+	double pipeline_ns = nsPerOp(signal.size(), [&] {
+		DecodePipeline pipeline;
+		pipeline_frames = 0;
+		pipeline.push(signal.data(), signal.size(), [&](std::shared_ptr<SensorMessage> message) {
+			pipeline_frames++;
+		});
+	});
+	results.push_back(BenchResult {"decode_pipeline", pipeline_ns, "ns/sample"});
+	results.push_back(BenchResult {"decode_pipeline_realtime", 1e9/(pipeline_ns*SAMP_RATE), "x"});	// Radios one core can keep up with
+	results.push_back(BenchResult {"decode_pipeline_frames", (double)pipeline_frames, "frames"});
+
+	// Same chain with a second 345 MHz receiver behind the decoder fanout, as a pluggable protocol decoder would be
+	results.push_back(BenchResult {"decode_pipeline_fanout", nsPerOp(signal.size(), [&] {
+		DecodePipeline pipeline;
+		pipeline.addDecoder(std::make_unique<SensorMessageReceiver>(PULSE_WIDTH*pipeline.getPlan().bbRate()));
+		pipeline.push(signal.data(), signal.size(), [&](std::shared_ptr<SensorMessage> message) {
+			sink += message->getTXID();
+		});
+	}), "ns/sample"});
+
+	return results;
+}
+
+
+/*
+ * 345 MHz receiver added behind a decoder fanout, keeps the frames it decodes and counts the samples it is fed, replays included
+ */
+class FanoutReceiver : public SensorMessageReceiver {
+public:
+	FanoutReceiver(const float& est_symbol_len) : SensorMessageReceiver(est_symbol_len) {};
+	std::shared_ptr<SensorMessage> push(const bool& sample) override {
+		samples++;
+		auto decoded = SensorMessageReceiver::push(sample);
+		if (decoded) {
+			frames.push_back(decoded);
+		}
+		return decoded;
+	};
+	std::vector<std::shared_ptr<SensorMessage>> frames;	// Kept alive, so they can be told apart by address
+	unsigned long int samples {0};
+};
+
+
+/*
+ * Decodes synthetic traffic, or idle air when there are no frames, with a second 345 MHz receiver added behind
+ * the decoder fanout, where it sleeps until its sync sequence ends and is woken by replaying the runs it missed.
+ * Returns false unless it decoded exactly the frames the built-in receiver did, and counted the same sync
+ * sequences and rejections, and on idle air unless it was fed under FANOUT_IDLE_MAX_FED of the samples.
+ */
+static bool checkFanout(const float& snr, const unsigned int& num_frames) {
+	FrameSynthesizer synthesizer(FrameSynthesizer::noiseAmplitude(0.5, snr));
+	for (unsigned int i = 0; i < num_frames; i++) {
+		synthesizer.addFrame(benchFrame(i));
+	}
+	if (!num_frames) {
+		synthesizer.addSilence(FANOUT_IDLE_SAMPLES);
+	}
+	const auto& signal = synthesizer.render();
+
+	DecodePipeline pipeline;
+	auto added = std::make_unique<FanoutReceiver>(PULSE_WIDTH*pipeline.getPlan().bbRate());
+	const auto& fanout_receiver = *added;
+	pipeline.addDecoder(std::move(added));
+
+	// Frames of both receivers come out of the pipeline, the added one's a sample or so later
+	std::vector<std::tuple<unsigned long int, unsigned int, unsigned int>> frames, fanout_frames;
+	pipeline.push(signal.data(), signal.size(), [&](std::shared_ptr<SensorMessage> message) {
+		auto& decoded_by = std::count(fanout_receiver.frames.begin(), fanout_receiver.frames.end(), message) ? fanout_frames : frames;
+		decoded_by.emplace_back(message->getTXID(), message->getState(), message->getManchesterErrors());
+	});
+	double fed = 100*fanout_receiver.samples/((double)signal.size()*pipeline.getPlan().bbRate()/pipeline.getPlan().samp_rate);
+
+	const auto& stats = pipeline.getReceiverStats();
+	const auto& fanout_stats = fanout_receiver.getStats();
+	bool same = (frames == fanout_frames) && (fanout_stats.synced.get() == stats.synced.get()) && (fanout_stats.rejected.get() == stats.rejected.get())
+			&& (fanout_stats.manchester_errors.get() == stats.manchester_errors.get());
+	for (unsigned int i = 0; i < NUM_VENDORS; i++) {
+		same &= (fanout_stats.crc_pass[i].get() == stats.crc_pass[i].get()) && (fanout_stats.crc_fail[i].get() == stats.crc_fail[i].get());
+	}
+
+	std::cout << "Decoder fanout " << (num_frames ? "at " : "on idle air at noise of ") << snr << " dB SNR: " << stats.synced.get() << " sync sequences, "
+			<< frames.size() << " frames, added receiver fed " << fed << "% of samples, " << (same ? "decoded the same" : "DECODED DIFFERENTLY") << std::endl;
+
+	return same && (num_frames || (fed < FANOUT_IDLE_MAX_FED));
+}
+
+
+/*
+ * Reads results saved by an earlier run, keyed on benchmark name
+ */
+static std::map<std::string, double> readResults(const char* path) {
+	std::map<std::string, double> results;
+	std::ifstream file(path);
+	std::string line;
+	std::getline(file, line);	// Header
+	while (std::getline(file, line)) {
+		auto name_start = line.find(',');
+		auto value_start = line.find(',', name_start+1);
+		if ((name_start == std::string::npos) | (value_start == std::string::npos)) {
+			continue;
+		}
+		results[line.substr(name_start+1, value_start-name_start-1)] = std::stod(line.substr(value_start+1));
+	}
+
+	return results;
+}
+
+
+void printHelp(char* command) {
+	std::cerr << "Usage:" << std::endl << command << " [OPTIONS]" << std::endl << std::endl;
+	std::cerr << "OPTIONS:" << std::endl;
+	std::cerr << "--revision REVISION: Label the results, e.g. with the git commit." << std::endl;
+	std::cerr << "--csv FILE: Save the results as CSV (revision,benchmark,value,unit)." << std::endl;
+	std::cerr << "--baseline FILE: Compare against results saved by an earlier run." << std::endl;
+}
+
+
+int main(int argc, char* argv[]) {
+	std::string revision = "unknown";
+	char* csv_path = nullptr;
+	char* baseline_path = nullptr;
+	for (signed int i = 1; i<argc; i++) {
+		if (!strcmp(argv[i], "--revision") & (i+1 < argc)) {
+			revision = argv[++i];
+		} else if (!strcmp(argv[i], "--csv") & (i+1 < argc)) {
+			csv_path = argv[++i];
+		} else if (!strcmp(argv[i], "--baseline") & (i+1 < argc)) {
+			baseline_path = argv[++i];
+		} else {
+			printHelp(argv[0]);
+			return strcmp(argv[i], "-h") && strcmp(argv[i], "--help") ? EXIT_FAILURE : EXIT_SUCCESS;
+		}
+	}
+
+	for (float snr : FANOUT_CHECK_SNRS) {
+		if (!checkFanout(snr, BENCH_FRAMES) || !checkFanout(snr, 0)) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	auto baseline = baseline_path ? readResults(baseline_path) : std::map<std::string, double>();
+	auto results = runBenchmarks();
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << std::left << std::setw(34) << "BENCHMARK (" + revision + ")" << std::right << std::setw(14) << "VALUE" << "  " << std::left << std::setw(12) << "UNIT"
+			<< std::right << (baseline.empty() ? "" : "      CHANGE") << std::endl;
+	for (const auto& result : results) {
+		std::cout << std::left << std::setw(34) << result.name << std::right << std::setw(14) << result.value << "  " << std::left << std::setw(12) << result.unit << std::right;
+		auto previous = baseline.find(result.name);
+		if ((previous != baseline.end()) && previous->second) {
+			std::cout << std::setw(11) << std::showpos << 100*(result.value/previous->second - 1) << "%" << std::noshowpos;
+		}
+		std::cout << std::endl;
+	}
+
+	if (csv_path) {
+		std::ofstream csv(csv_path);
+		csv << "revision,benchmark,value,unit" << std::endl << std::fixed << std::setprecision(3);
+		for (const auto& result : results) {
+			csv << revision << "," << result.name << "," << result.value << "," << result.unit << std::endl;
+		}
+		if (!csv) {
+			std::cerr << "Results could not be saved to \"" << csv_path << "\"." << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
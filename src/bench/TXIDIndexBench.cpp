@@ -0,0 +1,87 @@
+#include "../tracking/TXIDIndex.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <map>
+#include <algorithm>
+#include <vector>
+
+
+struct SensorEntry {	// Stand-in for SensorHistory without console output
+	unsigned char sensor_state;
+	unsigned int rx_msg_count;
+};
+
+
+template <typename FUNC>
+double nsPerOp(const size_t& ops, FUNC func) {
+	auto start = std::chrono::steady_clock::now();
+	func();
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count()/ops;
+}
+
+
+void benchmark(const size_t& num_sensors) {
+	std::mt19937_64 rng(num_sensors);
+	std::uniform_int_distribution<unsigned long int> txid_dist(1, 0xFFFFFFFF);	// Vivint-sized TXIDs
+
+	std::vector<unsigned long int> txids(num_sensors);
+	for (auto& txid : txids) {
+		txid = txid_dist(rng);
+	}
+
+	// Lookups follow a random order of known sensors, as repeated messages from a busy site would
+	std::vector<unsigned long int> lookups(std::max<size_t>(num_sensors, 1000000));
+	std::uniform_int_distribution<size_t> sensor_dist(0, num_sensors-1);
+	for (auto& txid : lookups) {
+		txid = txids[sensor_dist(rng)];
+	}
+
+	volatile unsigned int sink = 0;
+
+	TXIDIndex<SensorEntry> index;
+	double index_insert = nsPerOp(num_sensors, [&] {
+		for (const auto& txid : txids) {
+			if (!index.find(txid)) {
+				index.emplace(txid, SensorEntry {0, 1});
+			}
+		}
+	});
+	double index_lookup = nsPerOp(lookups.size(), [&] {
+		for (const auto& txid : lookups) {
+			sink += ++index.find(txid)->rx_msg_count;
+		}
+	});
+
+	std::map<const unsigned long int, SensorEntry> tree;
+	double tree_insert = nsPerOp(num_sensors, [&] {
+		for (const auto& txid : txids) {
+			tree.insert(std::pair<unsigned long int, SensorEntry>(txid, SensorEntry {0, 1}));
+		}
+	});
+	double tree_lookup = nsPerOp(lookups.size(), [&] {
+		for (const auto& txid : lookups) {
+			sink += ++tree.find(txid)->second.rx_msg_count;
+		}
+	});
+
+	std::cout << std::setw(9) << num_sensors
+			<< std::setw(12) << index.capacity()
+			<< std::setw(14) << index_insert << std::setw(14) << index_lookup
+			<< std::setw(14) << tree_insert << std::setw(14) << tree_lookup << std::endl;
+}
+
+
+int main() {
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "  SENSORS    CAPACITY   INDEX INSERT  INDEX LOOKUP    MAP INSERT    MAP LOOKUP  (ns/op)" << std::endl;
+	for (size_t num_sensors : {1000, 100000, 1000000}) {
+		benchmark(num_sensors);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,343 @@
+#include "DecodePipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+DecodePipeline::DecodePipeline(const unsigned char& receiver, EventSink* event_sink, const unsigned int& if_bandwidth, const RatePlan& plan) :
+		receiver(receiver),
+		plan(plan),
+		if_bandwidth(if_bandwidth),
+		// Configure BB (HPF) filters, the IF filter is configured once these are
+		BB_DC_remove(HPF, plan.ifRate(), BB_DC_FILT_DECIMATION, BB_DC_FILT_CUTOFF, BB_DC_FILT_TRANSITION, FILT_ATTENUATION),
+		BB_LP_filter(LPF, plan.ifRate()/BB_DC_FILT_DECIMATION, plan.bb_lp_decimation, BB_LP_FILT_CUTOFF, BB_LP_FILT_TRANSITION, FILT_ATTENUATION),
+		// Create decoder for 345 data with estimated sample per symbol value for finding sync bits.
+		// The decoder computes more accurate SPS estimations per-message using sync bits
+		// for overall SPS accuracy throughout the message.
+		message_receiver(PULSE_WIDTH*plan.bbRate(), event_sink) {
+
+	tuneIF(0, if_bandwidth);
+	setTime(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+
+void DecodePipeline::addDecoder(std::unique_ptr<ProtocolDecoder> decoder) {
+	decoders.add(decoder.get());
+	protocol_decoders.push_back(std::move(decoder));
+}
+
+
+/*
+ * Acquisition starts with the IF filter at the full sensor bandwidth, whatever the IF bandwidth
+ */
+void DecodePipeline::enableAFC() {
+	afc_enabled = true;
+	if (if_bandwidth < SENSOR_BW) {
+		tuneIF(0, SENSOR_BW);
+	}
+}
+
+
+/*
+ * Centres the IF filter on offset Hz from SIG_FREQ, offsets are whole Hz as the local oscillator requires.
+ * Once built, the filter is retuned in place, keeping the samples it holds.
+ */
+void DecodePipeline::tuneIF(const int& offset, const unsigned int& bandwidth) {
+	if (IFfilter) {
+		IFfilter->retune(plan.tune_offset - offset);
+		if (bandwidth/2 != if_cutoff) {
+			IFfilter->setCutoff(bandwidth/2);
+		}
+	} else {
+		// Complex LPF with frequency Xlation.
+		// The HackRF One samples have significant DC noise, so
+		// tuning the hardware to some offset frequency and translating
+		// the signal back to FFT center in the digital domain greatly
+		// improves SNR.
+		IFfilter.emplace(LPF, plan.samp_rate, plan.if_decimation, bandwidth/2, IF_FILT_TRANSITION, FILT_ATTENUATION, plan.tune_offset - offset);
+
+		// Each filter delays its input, later filters run at decimated rates
+		group_delay = std::lround(IFfilter->groupDelay() +
+				BB_DC_remove.groupDelay()*plan.if_decimation +
+				BB_LP_filter.groupDelay()*plan.if_decimation*BB_DC_FILT_DECIMATION);
+	}
+	if_cutoff = bandwidth/2;
+	if_offset = offset;
+}
+
+
+/*
+ * Follows the carrier offset of the sensor of a passed frame, called between frames. Offsets are
+ * smoothed so one bad estimate cannot pull the IF filter off the sensor.
+ */
+void DecodePipeline::updateAFC(const std::shared_ptr<SensorMessage>& sensor_message) {
+	if (!sensor_message || std::isnan(sensor_message->freq_offset)) {
+		return;
+	}
+
+	float max_offset = std::min<float>(AFC_MAX_OFFSET, plan.samp_rate/2.0 - std::abs(plan.tune_offset));	// Within reach of the local oscillator
+	float offset = std::clamp<float>(sensor_message->freq_offset, -max_offset, max_offset);
+	auto sensor = afc_sensors.find(sensor_message->getTXID());
+	if (sensor == afc_sensors.end()) {
+		afc_sensors.emplace(sensor_message->getTXID(), SensorOffset {offset, 1, sample_count});
+	} else {
+		sensor->second.offset += AFC_GAIN*(offset - sensor->second.offset);
+		sensor->second.frames++;
+		sensor->second.last_sample = sample_count;
+	}
+
+	retuneAFC();
+}
+
+
+/*
+ * Centres the IF filter between the lowest and highest tracked offsets, and narrows it to the IF
+ * bandwidth plus their spread and margins, never narrower than that nor wider than for acquisition.
+ * Offsets of sensors not heard for AFC_UNLOCK_TIME are dropped first.
+ */
+void DecodePipeline::retuneAFC() {
+	afc_check_sample = sample_count + (unsigned long long int)AFC_CHECK_INTERVAL*plan.samp_rate;
+
+	float low = AFC_MAX_OFFSET;
+	float high = -AFC_MAX_OFFSET;
+	unsigned int frames = 0;
+	for (auto sensor = afc_sensors.begin(); sensor != afc_sensors.end();) {
+		if (sample_count - sensor->second.last_sample > (unsigned long long int)AFC_UNLOCK_TIME*plan.samp_rate) {
+			sensor = afc_sensors.erase(sensor);
+			continue;
+		}
+		low = std::min(low, sensor->second.offset);
+		high = std::max(high, sensor->second.offset);
+		frames += sensor->second.frames;
+		sensor++;
+	}
+
+	unsigned int acquisition_bw = std::max<unsigned int>(if_bandwidth, SENSOR_BW);
+	int offset = 0;
+	unsigned int bandwidth = acquisition_bw;
+	if (frames >= AFC_LOCK_FRAMES) {
+		offset = std::lround((low + high)/(2*AFC_STEP))*AFC_STEP;
+		bandwidth = std::min<unsigned int>(acquisition_bw, if_bandwidth + std::lround(high - low) + 2*AFC_MARGIN);
+	}
+
+	if ((std::abs(offset - if_offset) >= AFC_STEP) || (std::abs((int)bandwidth/2 - (int)if_cutoff) >= AFC_STEP)
+			|| ((bandwidth == acquisition_bw) && (bandwidth/2 != if_cutoff))) {	// Widened fully when needed
+		tuneIF(offset, bandwidth);
+	}
+}
+
+
+void DecodePipeline::setTime(const long long int& time) {
+	clock_sample = sample_count;
+	clock_time = time;
+}
+
+
+/*
+ * Converts a sample number to ns since the Unix epoch, exactly for any run length
+ */
+long long int DecodePipeline::sampleTime(const unsigned long long int& sample) const {
+	long long int samples = sample - clock_sample;	// Negative for samples preceding the last alignment
+	long long int samp_rate = plan.samp_rate;
+	return clock_time + (samples / samp_rate)*NS_PER_SEC + ((samples % samp_rate)*NS_PER_SEC) / samp_rate;
+}
+
+
+std::shared_ptr<SensorMessage> DecodePipeline::push(const std::complex<float>& sample) {
+	return stats_enabled ? process<true>(sample) : process<false>(sample);
+}
+
+
+/*
+ * Runs one stage on a sample, counting its input and output and timing every STATS_TIMING_INTERVAL-th sample
+ */
+template <bool STATS, typename FUNC>
+auto DecodePipeline::runStage(const PipelineStage& stage, FUNC func) {
+	if constexpr (!STATS) {
+		return func();
+	} else {
+		bool timed = !(stats.samples_in[stage].get() % STATS_TIMING_INTERVAL);
+		stats.samples_in[stage].add();
+
+		long long int start = timed ? latencyClock() : 0;
+		auto output = func();
+		if (timed) {
+			stats.timed_ns[stage].add(latencyClock() - start);
+			stats.timed_samples[stage].add();
+		}
+
+		if (output) {
+			stats.samples_out[stage].add();
+		}
+
+		return output;
+	}
+}
+
+
+template <bool STATS>
+std::shared_ptr<SensorMessage> DecodePipeline::process(const std::complex<float>& sample) {
+	// Apply frequency translation and lowpass filter to IF
+	sample_count++;
+	if (spectrum_block) {	// Raw samples of an analysed block are checked for clipping
+		spectrum_block->raw_samples++;
+		spectrum_block->clipped += std::max(std::abs(sample.real()), std::abs(sample.imag())) >= SPECTRUM_CLIP_LEVEL;
+	}
+	auto filt_samp = runStage<STATS>(IF_FILTER, [&]() {return IFfilter->compute(sample);});
+	if (!filt_samp) {	// If this sample is decimated
+		return std::shared_ptr<SensorMessage>(nullptr);
+	}
+
+	return processIF<STATS>(*filt_samp);
+}
+
+
+template <bool STATS>
+std::shared_ptr<SensorMessage> DecodePipeline::processIF(const std::complex<float>& if_sample) {
+	if (tap) {
+		tapSample(TAP_IF, if_sample);
+	}
+
+	if (monitor) {
+		monitorSample(if_sample);
+	}
+
+	if (receiving()) {	// Phase steps between samples, weighted by their power, give the frame's carrier offset
+		frame_phase_steps += if_sample*std::conj(prev_if_sample);
+	}
+	prev_if_sample = if_sample;
+
+	// Compute magnitude (BB) and apply highpass filter to center signal at zero.
+	// This allows BB pulse widths to be determined by tracking zero-crossings.
+	auto power = if_sample.real()*if_sample.real() +	// Real^2
+			if_sample.imag()*if_sample.imag();	// Imag^2
+
+	return processBB<STATS>(power);
+}
+
+
+template <bool STATS>
+std::shared_ptr<SensorMessage> DecodePipeline::processBB(const float& power) {
+	if (tap) {
+		tapSample(TAP_BB, power);
+	}
+
+	if (signal_level & receiving()) {	// Measure signal strength over the pulses of a frame
+		frame_power += power;
+		frame_power_samples++;
+	}
+
+	auto BB_DC_remove_samp = runStage<STATS>(BB_DC_FILTER, [&]() {return BB_DC_remove.compute(power);});
+	if (!BB_DC_remove_samp) {	// If this sample is decimated
+		return std::shared_ptr<SensorMessage>(nullptr);
+	}
+
+	// Use a lowpass filter to clean up signal and reduce undesireable zero crossings
+	auto BB_LP_filt_samp = runStage<STATS>(BB_LP_FILTER, [&]() {return BB_LP_filter.compute(*BB_DC_remove_samp);});
+	if (!BB_LP_filt_samp) {	// If this sample is decimated
+		return std::shared_ptr<SensorMessage>(nullptr);
+	}
+
+	// Extract messages from square wave signal
+	signal_level = !std::signbit(*BB_LP_filt_samp);	// Float to square wave conversion
+													// 0 when <0, 1 when >=0
+	bool was_receiving = receiving();
+	if (was_receiving) {	// Only stamped within frames, to keep the clock off the idle path
+		sample_filtered = latencyClock();
+	}
+	auto sensor_message = runStage<STATS>(RECEIVER, [&]() {
+		auto decoded = message_receiver.push(signal_level);
+		if (!protocol_decoders.empty()) {	// Added decoders sleep until their sync sequence may be starting
+			decoded = decoders.push(signal_level, std::move(decoded));
+		}
+		return decoded;
+	});
+	if (!was_receiving & receiving()) {	// Sync sequence found, note where it ended at the antenna
+		frame_sample = sample_count - std::min(group_delay, sample_count);
+		framing = message_receiver.receiving() ? &message_receiver : decoders.getFraming();
+		frame_edges.add();
+	}
+	if (sensor_message) {
+		sensor_message->time = sampleTime(frame_sample);
+		sensor_message->latency_stamps.acquired = block_acquired;
+		sensor_message->latency_stamps.filtered = sample_filtered;
+		sensor_message->receiver = receiver;
+		if (frame_power_samples) {
+			sensor_message->rssi = 10*std::log10(frame_power/frame_power_samples);
+		}
+		if (frame_phase_steps != std::complex<float>()) {	// Not measured when decoding from a BB tap
+			sensor_message->freq_offset = if_offset + std::arg(frame_phase_steps)*plan.ifRate()/(2*M_PI);
+		}
+	}
+	if (was_receiving & !receiving()) {	// Frame ended
+		frame_edges.add();
+		if (recorder) {	// Capture it if it is of interest
+			recorder->trigger(framing->getOutcome(), framing->getFrameVendor(), sensor_message ? sensor_message->getTXID() : 0,
+					frame_sample, sample_count - std::min(group_delay, sample_count), sampleTime(frame_sample));
+		}
+		if (afc_enabled) {	// Retune between frames
+			updateAFC(sensor_message);
+		}
+	}
+
+	if (!receiving()) {	// Start measuring again with the next frame
+		frame_power = 0;
+		frame_power_samples = 0;
+		frame_phase_steps = {};
+		if (afc_enabled & (sample_count >= afc_check_sample)) {	// Offsets are also dropped while nothing passes
+			retuneAFC();
+		}
+	}
+
+	return sensor_message;
+}
+
+
+/*
+ * Saves a sample if the tap is on this stage, starting the tap file with the time of its first sample
+ */
+template <typename T>
+void DecodePipeline::tapSample(const TapStage& stage, const T& sample) {
+	if (tap->getStage() == stage) {
+		if (!tap->started()) {
+			tap->start(sampleTime(sample_count), plan, if_offset, if_cutoff, IFfilter->numTaps());
+		}
+		tap->write(sample);
+	}
+}
+
+
+/*
+ * Collects one in SPECTRUM_BLOCK_INTERVAL blocks of IF samples for the spectrum monitor
+ */
+void DecodePipeline::monitorSample(const std::complex<float>& if_sample) {
+	if (!spectrum_block) {
+		if (spectrum_skip) {
+			spectrum_skip--;
+			return;
+		}
+
+		spectrum_block = monitor->acquire();
+		spectrum_fill = 0;
+		if (!spectrum_block) {	// The monitor is behind, this block is skipped
+			spectrum_skip = SPECTRUM_BLOCK_INTERVAL*SPECTRUM_FFT_SIZE - 1;
+			return;
+		}
+	}
+
+	spectrum_block->samples[spectrum_fill++] = if_sample;
+	if (spectrum_fill == SPECTRUM_FFT_SIZE) {
+		monitor->submit(spectrum_block);
+		spectrum_block = nullptr;
+		spectrum_skip = (SPECTRUM_BLOCK_INTERVAL-1)*SPECTRUM_FFT_SIZE;
+	}
+}
+
+
+template std::shared_ptr<SensorMessage> DecodePipeline::process<true>(const std::complex<float>& sample);
+template std::shared_ptr<SensorMessage> DecodePipeline::process<false>(const std::complex<float>& sample);
+template std::shared_ptr<SensorMessage> DecodePipeline::processIF<true>(const std::complex<float>& if_sample);
+template std::shared_ptr<SensorMessage> DecodePipeline::processIF<false>(const std::complex<float>& if_sample);
+template std::shared_ptr<SensorMessage> DecodePipeline::processBB<true>(const float& power);
+template std::shared_ptr<SensorMessage> DecodePipeline::processBB<false>(const float& power);
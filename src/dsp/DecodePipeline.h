@@ -0,0 +1,223 @@
+#ifndef SRC_DECODEPIPELINE_H_
+#define SRC_DECODEPIPELINE_H_
+
+
+#include "Filter.h"
+#include "IQRecorder.h"
+#include "RatePlanner.h"
+#include "SpectrumMonitor.h"
+#include "StageTap.h"
+#include "../messaging/DecoderFanout.h"
+#include "../messaging/SensorMessageReceiver.h"
+#include "../util/StatCounter.h"
+
+#include <array>
+#include <complex>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#define SAMP_RATE 250e3	// Nominal plan, see RatePlanner.h
+#define SIG_FREQ 345006e3
+#define TUNE_FREQ_OFFSET -70e3	// Space the DC spike well away from the signal
+#define SENSOR_BW 40e3
+#define PULSE_WIDTH 130e-6	// 130 us
+
+#define FILT_ATTENUATION 3	// dB
+
+#define IF_FILT_TRANSITION 2500
+#define IF_FILT_DECIMATION 4
+
+#define BB_DC_FILT_CUTOFF 1530
+#define BB_DC_FILT_TRANSITION 450
+#define BB_DC_FILT_DECIMATION 1
+
+#define BB_LP_FILT_CUTOFF 9800
+#define BB_LP_FILT_TRANSITION 1400
+#define BB_LP_FILT_DECIMATION 2
+
+#define AFC_STEP 100	// Hz, the IF filter is retuned once its centre or cutoff would move this far
+#define AFC_GAIN 0.25	// Weight of each passed frame's offset in its sensor's tracked carrier offset
+#define AFC_MAX_OFFSET 40e3	// Hz, tracked carrier offsets are limited to this
+#define AFC_MARGIN 2000	// Hz, the IF filter is kept this much wider on each side than the tracked offsets need
+#define AFC_LOCK_FRAMES 3	// Frames passed by the sensors being tracked before the IF filter is narrowed
+#define AFC_UNLOCK_TIME 600	// Seconds without a passed frame before a sensor's offset is dropped, with none left the filter is widened to reacquire
+#define AFC_CHECK_INTERVAL 10	// Seconds between checks for dropped offsets while no frame passes
+
+#define STATS_TIMING_INTERVAL 64	// With stats enabled, one in this many samples is timed through each stage
+
+
+enum PipelineStage {IF_FILTER, BB_DC_FILTER, BB_LP_FILTER, RECEIVER, NUM_STAGES};
+
+
+/*
+ * Per-stage sample counters of one pipeline, only kept when stats are enabled
+ */
+struct alignas(CACHE_LINE_SIZE) PipelineStats {
+	std::array<StatCounter, NUM_STAGES> samples_in;
+	std::array<StatCounter, NUM_STAGES> samples_out;	// Samples passed to the next stage, messages for the receiver
+	std::array<StatCounter, NUM_STAGES> timed_samples;	// Samples timed through the stage, and their total time
+	std::array<StatCounter, NUM_STAGES> timed_ns;
+};
+
+
+/*
+ * Complete decode chain for one sample source, from CF32 samples to CRC-checked sensor messages.
+ * The filters run once, and their square wave is fanned out to each protocol decoder.
+ * Each radio gets its own pipeline so that radios can be decoded on separate threads, the
+ * pipeline shares nothing with other pipelines except the (thread-safe) event sink.
+ *
+ * Sample rates and decimations come from a RatePlan, the nominal plan unless the radio is better
+ * served by another.
+ *
+ * Messages are timestamped by counting samples, corrected for the group delay of the filters, so
+ * the decode path never reads the system clock. The sample clock starts at the wall-clock time the
+ * pipeline is created, and can be realigned with hardware timestamps using setTime().
+ *
+ * Stats are collected by a separately compiled copy of the sample path, selected once per block,
+ * so a pipeline without stats enabled does no counting at all.
+ *
+ * The carrier offset of each frame is estimated from the mean phase step of its IF samples. With AFC
+ * enabled, the offset of each sensor is tracked from its passed frames, as sensor crystals drift
+ * independently. Between frames the IF filter is centred on the tracked offsets, by moving its local
+ * oscillator alone, and narrowed towards the IF bandwidth as far as the spread of the offsets allows.
+ */
+class DecodePipeline {
+public:
+	DecodePipeline(const unsigned char& receiver = 0, EventSink* event_sink = nullptr, const unsigned int& if_bandwidth = SENSOR_BW,
+			const RatePlan& plan = nominalPlan());
+	std::shared_ptr<SensorMessage> push(const std::complex<float>& sample);
+	template <typename FUNC>
+	void push(const std::complex<float>* samples, const size_t& num_samples, FUNC func);	// Calls func(message) for each decoded message
+	template <typename FUNC>
+	void pushIF(const std::complex<float>* samples, const size_t& num_samples, FUNC func);	// IF filter output, as saved by a TAP_IF StageTap
+	template <typename FUNC>
+	void pushBB(const float* samples, const size_t& num_samples, FUNC func);	// IF power, as saved by a TAP_BB StageTap
+	void setTime(const long long int& time);	// Time of the next sample pushed, ns since the Unix epoch
+	void enableStats() {stats_enabled = true;};	// Before samples are pushed
+	void enableAFC();	// Before samples are pushed
+	void addDecoder(std::unique_ptr<ProtocolDecoder> decoder);	// Before samples are pushed, decoded alongside the 345 MHz SensorMessageReceiver
+	void recordTo(IQRecorder* recorder) {this->recorder = recorder;};	// Before samples are pushed, only block pushes of raw samples are recorded
+	void tapTo(StageTap* tap) {this->tap = tap;};	// Before samples are pushed
+	void monitorTo(SpectrumMonitor* monitor) {this->monitor = monitor;};	// Before samples are pushed
+	SpectrumMonitor* getMonitor() const {return monitor;};
+	unsigned long long int getFrameEdges() const {return frame_edges.get();};	// Any thread, odd while a frame is being received
+	unsigned int getIFTaps() const {return IFfilter->numTaps();};
+	unsigned int getIFCutoff() const {return if_cutoff;};	// Hz, of the current IF filter
+	int getCarrierOffset() const {return if_offset;};	// Hz from SIG_FREQ, that the IF filter is centred on
+	const RatePlan& getPlan() const {return plan;};
+	const PipelineStats& getStats() const {return stats;};
+	const ReceiverStats& getReceiverStats() const {return message_receiver.getStats();};
+private:
+	template <bool STATS>
+	std::shared_ptr<SensorMessage> process(const std::complex<float>& sample);
+	template <bool STATS>
+	std::shared_ptr<SensorMessage> processIF(const std::complex<float>& if_sample);
+	template <bool STATS>
+	std::shared_ptr<SensorMessage> processBB(const float& power);
+	template <typename T>
+	void tapSample(const TapStage& stage, const T& sample);
+	void monitorSample(const std::complex<float>& if_sample);
+	template <bool STATS, typename FUNC>
+	auto runStage(const PipelineStage& stage, FUNC func);
+	long long int sampleTime(const unsigned long long int& sample) const;
+	bool receiving() const {return message_receiver.receiving() || decoders.receiving();};	// By any decoder
+	void tuneIF(const int& offset, const unsigned int& bandwidth);
+	void updateAFC(const std::shared_ptr<SensorMessage>& sensor_message);
+	void retuneAFC();
+	const unsigned char receiver;	// Index of the radio feeding this pipeline, attached to its messages
+	const RatePlan plan;
+	const unsigned int if_bandwidth;	// Hz, of the IF filter when not acquiring with AFC
+	std::optional<Filter<std::complex<float>>> IFfilter;	// Rebuilt when retuned
+	unsigned int if_cutoff {};	// Hz, of the current IF filter
+	int if_offset {};	// Hz from SIG_FREQ, that the current IF filter is centred on
+	Filter<float> BB_DC_remove;
+	Filter<float> BB_LP_filter;
+	SensorMessageReceiver message_receiver;	// Fed every sample, its sync search is as cheap as a prematch
+	std::vector<std::unique_ptr<ProtocolDecoder>> protocol_decoders;	// Added decoders
+	DecoderFanout decoders;	// Of the square wave to the added decoders
+	const ProtocolDecoder* framing {&message_receiver};	// Decoder of the most recent frame
+	bool signal_level {};	// Last square wave level passed to the receiver
+	double frame_power {};	// Signal power summed over the pulses of the frame being received
+	unsigned int frame_power_samples {};
+	std::complex<float> prev_if_sample {};
+	std::complex<float> frame_phase_steps {};	// Summed over the frame being received, its angle is the mean phase step
+	struct SensorOffset {
+		float offset;	// Hz from SIG_FREQ
+		unsigned int frames;	// Passed
+		unsigned long long int last_sample;	// Of the last passed frame
+	};
+	bool afc_enabled {false};
+	std::unordered_map<unsigned long int, SensorOffset> afc_sensors;	// By TXID, of sensors that passed a frame within AFC_UNLOCK_TIME
+	unsigned long long int afc_check_sample {};	// Sample at which dropped offsets are next checked for
+	unsigned long long int sample_count {};	// Samples pushed so far
+	unsigned long long int clock_sample {};	// Sample at which the sample clock was last aligned
+	long long int clock_time;	// Time of clock_sample, ns since the Unix epoch
+	unsigned long long int group_delay;	// Samples between a sample entering the pipeline and reaching the receiver
+	unsigned long long int frame_sample {};	// Sample at which the current frame's sync sequence ended
+	StatCounter frame_edges;	// Frame starts and ends, read by other threads to find quiet periods
+	long long int block_acquired {};	// Latency stamps, see LatencyStamps
+	long long int sample_filtered {};
+	bool stats_enabled {false};
+	PipelineStats stats;
+	IQRecorder* recorder {nullptr};	// Raw samples are not recorded when there is no recorder
+	StageTap* tap {nullptr};	// No stage is saved when there is no tap
+	SpectrumMonitor* monitor {nullptr};	// The spectrum is not analysed when there is no monitor
+	SpectrumBlock* spectrum_block {nullptr};	// Being filled for the monitor, none between analysed blocks
+	unsigned int spectrum_fill {};	// IF samples in spectrum_block
+	unsigned int spectrum_skip {};	// IF samples left until the next analysed block
+};
+
+
+template <typename FUNC>
+void DecodePipeline::push(const std::complex<float>* samples, const size_t& num_samples, FUNC func) {
+	block_acquired = latencyClock();	// Called as soon as the block is read
+	if (recorder) {
+		recorder->record(samples, num_samples);
+	}
+
+	for (size_t i = 0; i < num_samples; i++) {
+		auto sensor_message = stats_enabled ? process<true>(samples[i]) : process<false>(samples[i]);	// Predicted the same way for the whole block
+		if (sensor_message) {
+			func(std::move(sensor_message));
+		}
+	}
+
+	if (recorder) {
+		recorder->flush();
+	}
+}
+
+
+/*
+ * Resumes decoding after the IF filter. Each sample stands for the IF decimation in raw samples, so the
+ * sample clock runs as it would have for the raw samples.
+ */
+template <typename FUNC>
+void DecodePipeline::pushIF(const std::complex<float>* samples, const size_t& num_samples, FUNC func) {
+	block_acquired = latencyClock();
+	for (size_t i = 0; i < num_samples; i++) {
+		auto sensor_message = stats_enabled ? processIF<true>(samples[i]) : processIF<false>(samples[i]);
+		sample_count += plan.if_decimation;
+		if (sensor_message) {
+			func(std::move(sensor_message));
+		}
+	}
+}
+
+
+template <typename FUNC>
+void DecodePipeline::pushBB(const float* samples, const size_t& num_samples, FUNC func) {
+	block_acquired = latencyClock();
+	for (size_t i = 0; i < num_samples; i++) {
+		auto sensor_message = stats_enabled ? processBB<true>(samples[i]) : processBB<false>(samples[i]);
+		sample_count += plan.if_decimation;
+		if (sensor_message) {
+			func(std::move(sensor_message));
+		}
+	}
+}
+
+
+#endif /* SRC_DECODEPIPELINE_H_ */
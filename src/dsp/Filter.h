@@ -15,10 +15,16 @@ class Filter {
 public:
 	Filter(const filterType& filt_t, const unsigned int& samp_rate, const unsigned int& decimation, const unsigned int& cutoff_freq, const unsigned int& transition_width, const unsigned int& attenuation, const int& xlation_freq = 0);
 	T* compute(const T& sample);
+	void retune(const int& xlation_freq);	// Moves the frequency translation, the local oscillator's phase carries on
+	void setCutoff(const unsigned int& cutoff_freq);	// Of a LPF, the samples held are kept
+	float groupDelay() const {return (num_taps-1)/2.0;};	// Input samples, symmetric taps delay all frequencies equally
+	unsigned int numTaps() const {return num_taps;};
+	static unsigned int estimateTaps(const unsigned int& samp_rate, const unsigned int& transition_width, const unsigned int& attenuation);
 private:
 	void computeLPFTaps(const unsigned int& samp_rate, const unsigned int& cutoff_freq);
 	void computeHPFTaps(const unsigned int& samp_rate, const unsigned int& cutoff_freq);
 	std::unique_ptr<SignalGenerator<T>> localOscillator;
+	const unsigned int samp_rate;
 	unsigned int num_taps;
 	const unsigned int decimation;
 	std::unique_ptr<float[]> taps;
@@ -30,7 +36,7 @@ private:
 
 template <typename T>
 Filter<T>::Filter(const filterType& filt_t, const unsigned int& samp_rate, const unsigned int& decimation, const unsigned int& cutoff_freq, const unsigned int& transition_width, const unsigned int& attenuation, const int& xlation_freq)
-	: decimation(decimation) {
+	: samp_rate(samp_rate), decimation(decimation) {
 
 	// Check for divide by zero scenarios
 	if (!samp_rate) {
@@ -45,14 +51,7 @@ Filter<T>::Filter(const filterType& filt_t, const unsigned int& samp_rate, const
 		throw ATTENUATION_ZERO;
 	}
 
-	float normalized_transition = 1.0*transition_width/samp_rate;
-	float est_num_taps = attenuation/(22.0*normalized_transition);	// Harris Approximation
-
-	// Use odd taps (type 1 filter)
-	num_taps = ceil(est_num_taps);	// Try rounding up first
-	if ((num_taps % 2) == 0) {	// If rounding up does not result in an odd value, then round down
-		num_taps--;
-	}
+	num_taps = estimateTaps(samp_rate, transition_width, attenuation);
 
 	shift_register = std::make_unique<T[]>(num_taps);
 	taps = std::make_unique<float[]>(num_taps);
@@ -69,6 +68,51 @@ Filter<T>::Filter(const filterType& filt_t, const unsigned int& samp_rate, const
 }
 
 
+/*
+ * The new oscillator starts at the phase the old one would have produced next, so the samples already
+ * mixed into the shift register and the ones that follow stay continuous
+ */
+template <typename T>
+void Filter<T>::retune(const int& xlation_freq) {
+	float phase = 0;
+	if (localOscillator) {
+		phase = localOscillator->nextPhase() - (2*M_PI*xlation_freq)/samp_rate;	// Step 0 is skipped by the first sample()
+	}
+
+	localOscillator.reset();
+	if (xlation_freq != 0) {
+		localOscillator = std::make_unique<SignalGenerator<T>>(samp_rate, xlation_freq, phase);
+	}
+}
+
+
+/*
+ * The number of taps only depends on the transition width, so only their values change
+ */
+template <typename T>
+void Filter<T>::setCutoff(const unsigned int& cutoff_freq) {
+	computeLPFTaps(samp_rate, cutoff_freq);
+}
+
+
+/*
+ * Taps needed for a transition width and attenuation, without building the filter
+ */
+template <typename T>
+unsigned int Filter<T>::estimateTaps(const unsigned int& samp_rate, const unsigned int& transition_width, const unsigned int& attenuation) {
+	float normalized_transition = 1.0*transition_width/samp_rate;
+	float est_num_taps = attenuation/(22.0*normalized_transition);	// Harris Approximation
+
+	// Use odd taps (type 1 filter)
+	unsigned int num_taps = ceil(est_num_taps);	// Try rounding up first
+	if ((num_taps % 2) == 0) {	// If rounding up does not result in an odd value, then round down
+		num_taps--;
+	}
+
+	return num_taps;
+}
+
+
 template <typename T>
 T* Filter<T>::compute(const T& sample) {
 	// Shift in new sample
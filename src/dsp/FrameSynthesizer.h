@@ -0,0 +1,193 @@
+#ifndef SRC_FRAMESYNTHESIZER_H_
+#define SRC_FRAMESYNTHESIZER_H_
+
+
+#include "DecodePipeline.h"
+#include "SignalGenerator.h"
+#include "../messaging/CRC16.h"
+#include "../messaging/FrameLayout.h"
+
+#include <cmath>
+#include <complex>
+#include <map>
+#include <random>
+#include <vector>
+
+#define SYNTH_REPEAT_GAP 3000	// Samples of silence between repeats of a frame
+#define SYNTH_FRAME_GAP 20000	// Samples of silence after the repeats of a frame
+
+
+/*
+ * Contents of a synthesized frame, fields not in the vendor's layout are ignored
+ */
+struct SyntheticFrame {
+	Vendor vendor;
+	unsigned long int txid;
+	unsigned char sensor_state;
+	unsigned long int header;
+	unsigned char devid;
+};
+
+
+/*
+ * Builds CF32 test signals at SAMP_RATE, as the radio would receive them before tuning offset removal:
+ * sync sequence, then each field of the vendor frame layout Manchester encoded, then the CRC, on-off
+ * keyed onto a carrier at -TUNE_FREQ_OFFSET. Transmissions may overlap, they are summed, and Gaussian
+ * noise is added over the whole signal when it is rendered.
+ */
+class FrameSynthesizer {
+public:
+	FrameSynthesizer(const float& noise_amplitude = 0.05, const float& signal_amplitude = 0.5, const unsigned int& seed = 1) :
+		noise_amplitude(noise_amplitude), signal_amplitude(signal_amplitude), rng(seed) {};
+	size_t addFrame(const SyntheticFrame& frame, const unsigned int& repeats = 3);	// After everything added so far, returns its start sample
+	void addFrame(const SyntheticFrame& frame, const size_t& start, const unsigned int& repeats,
+			const double& symbol_rate_scale = 1, const int& freq_offset = 0);	// Sensor clock error (1 is nominal), carrier offset in Hz
+	void addSilence(const size_t& num_samples);
+	size_t size() const {return signal.size();};
+	const std::vector<std::complex<float>>& render();	// Adds noise once, no frames may be added afterwards
+	static std::vector<bool> encode(const SyntheticFrame& frame);	// On-off levels, each PULSE_WIDTH long at the nominal symbol rate
+	static float noiseAmplitude(const float& signal_amplitude, const float& snr);	// For an SNR in dB, measured in SENSOR_BW
+private:
+	static void addManchester(std::vector<bool>& levels, const unsigned long int& data, const unsigned int& num_bits);
+	SignalGenerator<std::complex<float>>& carrier(const int& freq_offset);
+	const float noise_amplitude;
+	const float signal_amplitude;
+	std::map<int, SignalGenerator<std::complex<float>>> carriers;	// By frequency offset
+	std::mt19937 rng;
+	std::normal_distribution<float> noise;
+	bool rendered {false};
+	std::vector<std::complex<float>> signal;
+};
+
+
+inline void FrameSynthesizer::addManchester(std::vector<bool>& levels, const unsigned long int& data, const unsigned int& num_bits) {
+	for (int i = num_bits-1; i >= 0; i--) {	// MSB first, 1 is LO HI and 0 is HI LO
+		bool bit = (data>>i) & 0x1;
+		levels.push_back(!bit);
+		levels.push_back(bit);
+	}
+}
+
+
+inline std::vector<bool> FrameSynthesizer::encode(const SyntheticFrame& frame) {
+	std::vector<bool> levels;
+	for (int i = 31; i >= 0; i--) {	// Sync sequence is sent as raw levels
+		levels.push_back((SYNC_LEVELS_FORMAT>>i) & 0x1);
+	}
+
+	unsigned int channel = 0;
+	while ((channel < vendor_channel_map.size()) && (vendor_channel_map[channel] != frame.vendor)) {
+		channel++;
+	}
+	channel %= vendor_channel_map.size();	// UNKNOWN has no channel of its own, use an unmapped one
+
+	const FrameFormat* format = Vendors::formats[frame.vendor];
+	CRC16 crc16;
+	crc16.setPoly(format->crc_poly);
+	crc16.push(channel, CHANNEL_BITS);
+	addManchester(levels, channel, CHANNEL_BITS);
+
+	for (const FrameField* field = format->fields; field->field != CRC; field++) {
+		unsigned long int data = 0;
+		switch (field->field) {
+		case HEADER:
+			data = frame.header;
+			break;
+		case DEVID:
+			data = frame.devid;
+			break;
+		case TXID:
+			data = frame.txid;
+			break;
+		case SENSOR_STATE:
+			data = frame.sensor_state;
+			break;
+		default:
+			break;
+		}
+		data &= (0x1ull<<field->bits)-1;
+
+		crc16.push(data, field->bits);
+		addManchester(levels, data, field->bits);
+	}
+	addManchester(levels, crc16.getCRC(), CRC_BITS);
+
+	return levels;
+}
+
+
+inline float FrameSynthesizer::noiseAmplitude(const float& signal_amplitude, const float& snr) {
+	// Complex noise of amplitude a has power 2a^2 spread over SAMP_RATE, of which SENSOR_BW/SAMP_RATE falls in the sensor band
+	return signal_amplitude / std::sqrt(2*std::pow(10, snr/10)*SENSOR_BW/SAMP_RATE);
+}
+
+
+inline SignalGenerator<std::complex<float>>& FrameSynthesizer::carrier(const int& freq_offset) {
+	auto generator = carriers.find(freq_offset);
+	if (generator == carriers.end()) {
+		generator = carriers.emplace(std::piecewise_construct, std::forward_as_tuple(freq_offset),
+				std::forward_as_tuple(SAMP_RATE, -TUNE_FREQ_OFFSET + freq_offset)).first;
+	}
+
+	return generator->second;
+}
+
+
+inline void FrameSynthesizer::addFrame(const SyntheticFrame& frame, const size_t& start, const unsigned int& repeats,
+		const double& symbol_rate_scale, const int& freq_offset) {
+	auto levels = encode(frame);
+	auto& frame_carrier = carrier(freq_offset);
+	double level_len = PULSE_WIDTH*SAMP_RATE/symbol_rate_scale;
+
+	double position = start;	// Fractional, keeps pulse timing from drifting
+	for (unsigned int i = 0; i < repeats; i++) {
+		for (auto level : levels) {
+			size_t level_start = std::lround(position);
+			position += level_len;
+			size_t level_end = std::lround(position);
+			if (signal.size() < level_end) {
+				signal.resize(level_end);
+			}
+
+			for (size_t sample = level_start; sample < level_end; sample++) {
+				auto carrier_sample = frame_carrier.sample();	// Keep carrier phase continuous through the off levels
+				if (level) {
+					signal[sample] += carrier_sample*signal_amplitude;
+				}
+			}
+		}
+		position += SYNTH_REPEAT_GAP;
+	}
+
+	size_t end = std::lround(position) + SYNTH_FRAME_GAP;
+	if (signal.size() < end) {
+		signal.resize(end);
+	}
+}
+
+
+inline size_t FrameSynthesizer::addFrame(const SyntheticFrame& frame, const unsigned int& repeats) {
+	size_t start = signal.size();
+	addFrame(frame, start, repeats);
+	return start;
+}
+
+
+inline void FrameSynthesizer::addSilence(const size_t& num_samples) {
+	signal.resize(signal.size() + num_samples);
+}
+
+
+inline const std::vector<std::complex<float>>& FrameSynthesizer::render() {
+	if (!rendered) {
+		for (auto& sample : signal) {
+			sample += std::complex<float>(noise(rng), noise(rng))*noise_amplitude;
+		}
+		rendered = true;
+	}
+
+	return signal;
+}
+
+
+#endif /* SRC_FRAMESYNTHESIZER_H_ */
@@ -0,0 +1,106 @@
+#include "GainController.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+GainController::GainController(const DecodePipeline& pipeline, SpectrumMonitor& monitor, const double& gain,
+		const double& min_gain, const double& max_gain, GainSetter set_gain) :
+		pipeline(pipeline), monitor(monitor), min_gain(min_gain), max_gain(max_gain), set_gain(set_gain), gain(gain) {
+
+	controller_thread = std::thread(&GainController::run, this);
+}
+
+
+GainController::~GainController() {
+	running.store(false, std::memory_order_release);
+	controller_thread.join();
+}
+
+
+void GainController::run() {
+	auto measure_start = std::chrono::steady_clock::now();
+	auto measured_from = monitor.totals();
+	bool settling = false;
+	auto quiet_since = measure_start;
+	auto frame_edges = pipeline.getFrameEdges();
+	int change = 0;	// Decided, waiting for a quiet moment
+
+	while (running.load(std::memory_order_acquire)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(GAIN_POLL_INTERVAL));
+		auto now = std::chrono::steady_clock::now();
+		if (pipeline.getFrameEdges() != frame_edges) {
+			frame_edges = pipeline.getFrameEdges();
+			quiet_since = now;
+		}
+
+		if (settling) {	// Start measuring again once the radio has settled at the new gain
+			if (now - measure_start >= std::chrono::milliseconds(GAIN_SETTLE)) {
+				settling = false;
+				measure_start = now;
+				measured_from = monitor.totals();
+			}
+			continue;
+		}
+
+		if (!change) {
+			if (now - measure_start < std::chrono::seconds(GAIN_PERIOD)) {
+				continue;
+			}
+			auto totals = monitor.totals();
+			change = decide(totals - measured_from);
+			measure_start = now;
+			measured_from = totals;
+		}
+
+		if (!change || (frame_edges & 1) || (now - quiet_since < std::chrono::milliseconds(GAIN_QUIET_TIME))) {
+			continue;
+		}
+
+		double current = gain.load(std::memory_order_relaxed);
+		double target = std::clamp(current + change*GAIN_STEP, min_gain, max_gain);
+		change = 0;
+		if (target == current) {	// Already at the limit of the element
+			continue;
+		}
+
+		double applied = set_gain(target);
+		gain.store(applied, std::memory_order_relaxed);
+		if (applied > current) {
+			raised.fetch_add(1, std::memory_order_relaxed);
+		} else if (applied < current) {
+			lowered.fetch_add(1, std::memory_order_relaxed);
+		}
+		settling = true;
+		measure_start = now;
+	}
+}
+
+
+int GainController::decide(const SpectrumStats& period) {
+	if (!period.raw_samples) {	// No samples analysed
+		return 0;
+	}
+
+	double clipped = 1.0*period.clipped/period.raw_samples;
+	unsigned long long int quiet_blocks = period.blocks - period.occupied;
+	double noise_floor = quiet_blocks ? 10*std::log10(std::max(period.noise_floor/quiet_blocks, 1e-30)) : 0;
+	bool floor_known = quiet_blocks >= GAIN_MIN_BLOCKS;
+
+	if ((clipped > GAIN_CLIP_HIGH) || (floor_known && (noise_floor > GAIN_FLOOR_HIGH))) {
+		raise_periods = 0;
+		return -1;
+	}
+
+	if (floor_known && (noise_floor < GAIN_FLOOR_LOW) && (clipped < GAIN_CLIP_LOW)) {
+		if (++raise_periods >= GAIN_RAISE_PERIODS) {
+			raise_periods = 0;
+			return 1;
+		}
+	} else {
+		raise_periods = 0;
+	}
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef SRC_GAINCONTROLLER_H_
+#define SRC_GAINCONTROLLER_H_
+
+
+#include "DecodePipeline.h"
+#include "SpectrumMonitor.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#define GAIN_STEP 8	// dB per change, the step of the HackRF One LNA
+#define GAIN_PERIOD 5	// Seconds of spectrum statistics behind each decision
+#define GAIN_RAISE_PERIODS 6	// Consecutive periods calling for more gain before it is raised, it is lowered after one
+#define GAIN_SETTLE 500	// Milliseconds of statistics discarded after a change
+#define GAIN_QUIET_TIME 250	// Milliseconds without a frame starting or ending before the gain is changed
+#define GAIN_POLL_INTERVAL 20	// Milliseconds between checks of the controller thread
+#define GAIN_MIN_BLOCKS 16	// Burst-free spectrum blocks needed to judge the noise floor
+#define GAIN_CLIP_HIGH 1e-4	// Fraction of raw samples clipped above which the gain is lowered
+#define GAIN_CLIP_LOW 1e-6	// Fraction of raw samples clipped below which the gain may be raised
+#define GAIN_FLOOR_HIGH -45	// dBFS/bin, noise floor above which the gain is lowered, noise is taking up the headroom
+#define GAIN_FLOOR_LOW -65	// dBFS/bin, noise floor below which the gain is raised, samples are limited by quantization
+
+
+/*
+ * Adjusts one gain element of a radio from its spectrum statistics, on a background thread. Clipping
+ * or a noise floor high in the ADC range lowers the gain, a noise floor near quantization raises it.
+ * The floor thresholds are further apart than a step, and raising needs several periods in a row, so
+ * the gain settles rather than hunting. Changes are held back until no frame has started or ended for
+ * GAIN_QUIET_TIME, so they fall between bursts rather than in the middle of a frame.
+ */
+class GainController {
+public:
+	using GainSetter = std::function<double(const double&)>;	// Sets the gain in dB, returns the gain the radio settled on
+	GainController(const DecodePipeline& pipeline, SpectrumMonitor& monitor, const double& gain,
+			const double& min_gain, const double& max_gain, GainSetter set_gain);
+	~GainController();
+	double getGain() const {return gain.load(std::memory_order_relaxed);};	// dB
+	unsigned long long int getRaised() const {return raised.load(std::memory_order_relaxed);};
+	unsigned long long int getLowered() const {return lowered.load(std::memory_order_relaxed);};
+private:
+	void run();
+	int decide(const SpectrumStats& period);	// -1 to lower the gain, 1 to raise it, 0 to hold
+	const DecodePipeline& pipeline;
+	SpectrumMonitor& monitor;
+	const double min_gain;
+	const double max_gain;
+	const GainSetter set_gain;
+	unsigned int raise_periods {0};	// Controller thread only
+	std::atomic<double> gain;
+	std::atomic<unsigned long long int> raised {0};
+	std::atomic<unsigned long long int> lowered {0};
+	std::atomic<bool> running {true};
+	std::thread controller_thread;
+};
+
+
+#endif /* SRC_GAINCONTROLLER_H_ */
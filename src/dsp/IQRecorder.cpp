@@ -0,0 +1,68 @@
+#include "IQRecorder.h"
+#include "DecodePipeline.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+IQRecorder::IQRecorder(CaptureWriter& writer, const unsigned char& receiver, const unsigned int& triggers) :
+		writer(writer), receiver(receiver), triggers(triggers), ring(std::make_unique<int8_t[]>(CAPTURE_RING_SAMPLES*2)) {}
+
+
+void IQRecorder::record(const std::complex<float>* samples, const size_t& num_samples) {
+	for (size_t i = 0; i < num_samples; i++) {
+		size_t slot = ((recorded+i) & (CAPTURE_RING_SAMPLES-1))*2;
+		ring[slot] = std::nearbyint(std::clamp(samples[i].real()*127.0f, -127.0f, 127.0f));
+		ring[slot+1] = std::nearbyint(std::clamp(samples[i].imag()*127.0f, -127.0f, 127.0f));
+	}
+	recorded += num_samples;
+}
+
+
+/*
+ * Called when a frame ends, with its sync and end sample numbers and the time of its sync
+ */
+void IQRecorder::trigger(const FrameOutcome& outcome, const Vendor& vendor, const unsigned long int& txid,
+		const unsigned long long int& frame_start, const unsigned long long int& frame_end, const long long int& frame_time) {
+	static const char* trigger_names[] = {"sync", "pass", "fail"};	// By FrameOutcome, rejected frames are only captured on sync
+	static const unsigned int trigger_flags[] = {CAPTURE_SYNC, CAPTURE_PASS | CAPTURE_SYNC, CAPTURE_FAIL | CAPTURE_SYNC};
+	if (!(triggers & trigger_flags[outcome])) {
+		return;
+	}
+
+	// The window must still be in the ring when it is flushed, up to a block after it ends, so long frames are cut short at the front
+	unsigned long long int end = frame_end + CAPTURE_POST_TRIGGER;
+	unsigned long long int oldest = (end + CAPTURE_RING_SAMPLES/4 > CAPTURE_RING_SAMPLES) ? end + CAPTURE_RING_SAMPLES/4 - CAPTURE_RING_SAMPLES : 0;
+	unsigned long long int start = std::max(frame_start - std::min(frame_start, (unsigned long long int)CAPTURE_PRE_TRIGGER), oldest);
+
+	auto capture = std::make_unique<Capture>();
+	capture->receiver = receiver;
+	capture->trigger = trigger_names[outcome];
+	capture->vendor = vendor;
+	capture->txid = txid;
+	capture->start_time = frame_time + ((long long int)start - (long long int)frame_start)*NS_PER_SEC/(long long int)SAMP_RATE;
+	capture->frame_start = frame_start - std::min(frame_start, start);
+	capture->frame_end = frame_end - start;
+	pending.push_back(PendingCapture {std::move(capture), start, end});
+}
+
+
+void IQRecorder::flush() {
+	for (auto capture = pending.begin(); capture != pending.end();) {
+		if (capture->end > recorded) {
+			capture++;
+			continue;
+		}
+
+		auto& samples = capture->capture->samples;
+		samples.reserve((capture->end - capture->start)*2);
+		for (auto sample = capture->start; sample < capture->end; sample++) {
+			size_t slot = (sample & (CAPTURE_RING_SAMPLES-1))*2;
+			samples.push_back(ring[slot]);
+			samples.push_back(ring[slot+1]);
+		}
+
+		writer.write(std::move(capture->capture));
+		capture = pending.erase(capture);
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef SRC_IQRECORDER_H_
+#define SRC_IQRECORDER_H_
+
+
+#include "../messaging/SensorMessageReceiver.h"
+#include "../output/CaptureWriter.h"
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#define CAPTURE_RING_SAMPLES (1<<19)	// Raw samples kept, about 2 seconds at 250 kS/s in 1 MiB of CS8
+#define CAPTURE_PRE_TRIGGER 25000	// Samples kept before a frame's sync sequence
+#define CAPTURE_POST_TRIGGER 12500	// Samples kept after a frame ends
+
+
+/*
+ * Keeps the most recent raw samples of one pipeline in a ring, as CS8, and cuts the window around
+ * each triggering frame out of it for a CaptureWriter. The ring is only touched by the pipeline's
+ * thread, a window is copied out once its post-trigger samples have arrived and is then handed to
+ * the writer through its lock-free queue.
+ *
+ * Samples are numbered from the first one recorded, which must match the pipeline's sample count.
+ * Blocks recorded at once must be well under a quarter of the ring.
+ */
+class IQRecorder {
+public:
+	IQRecorder(CaptureWriter& writer, const unsigned char& receiver, const unsigned int& triggers);
+	void record(const std::complex<float>* samples, const size_t& num_samples);
+	void trigger(const FrameOutcome& outcome, const Vendor& vendor, const unsigned long int& txid,
+			const unsigned long long int& frame_start, const unsigned long long int& frame_end, const long long int& frame_time);
+	void flush();	// Hands over the windows whose post-trigger samples have all been recorded
+private:
+	struct PendingCapture {
+		std::unique_ptr<Capture> capture;
+		unsigned long long int start;	// Window, by sample number
+		unsigned long long int end;
+	};
+	CaptureWriter& writer;
+	const unsigned char receiver;
+	const unsigned int triggers;	// CAPTURE_SYNC, CAPTURE_PASS and CAPTURE_FAIL flags
+	std::unique_ptr<int8_t[]> ring;	// Interleaved I and Q
+	unsigned long long int recorded {0};	// Samples recorded so far
+	std::vector<PendingCapture> pending;
+};
+
+
+#endif /* SRC_IQRECORDER_H_ */
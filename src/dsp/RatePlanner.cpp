@@ -0,0 +1,106 @@
+#include "RatePlanner.h"
+#include "DecodePipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+
+unsigned int RatePlan::bbRate() const {
+	return ifRate()/(BB_DC_FILT_DECIMATION*bb_lp_decimation);
+}
+
+
+RatePlan nominalPlan() {
+	RatePlan plan {};
+	plan.samp_rate = SAMP_RATE;
+	plan.tune_offset = TUNE_FREQ_OFFSET;
+	plan.if_decimation = IF_FILT_DECIMATION;
+	plan.bb_lp_decimation = BB_LP_FILT_DECIMATION;
+	plan.cost = planCost(plan);
+
+	return plan;
+}
+
+
+/*
+ * Counts the multiplies of each filter, an IF sample costs twice as many as a BB sample since it is complex
+ */
+double planCost(const RatePlan& plan) {
+	unsigned int if_rate = plan.ifRate();
+	unsigned int if_taps = Filter<std::complex<float>>::estimateTaps(plan.samp_rate, IF_FILT_TRANSITION, FILT_ATTENUATION);
+	unsigned int dc_taps = Filter<float>::estimateTaps(if_rate, BB_DC_FILT_TRANSITION, FILT_ATTENUATION);
+	unsigned int lp_taps = Filter<float>::estimateTaps(if_rate/BB_DC_FILT_DECIMATION, BB_LP_FILT_TRANSITION, FILT_ATTENUATION);
+
+	return 4.0*plan.samp_rate	// Local oscillator, one complex multiply per raw sample
+			+ 2.0*if_rate*if_taps
+			+ 2.0*if_rate	// Power
+			+ (double)if_rate/BB_DC_FILT_DECIMATION*dc_taps
+			+ (double)plan.bbRate()*lp_taps;
+}
+
+
+/*
+ * Tunes the radio just far enough from the signal to keep the DC spike out of the IF band, then
+ * searches the supported rates and decimations for the fewest multiplies that still:
+ *  - fit the whole IF band, and its transition, under the raw Nyquist frequency
+ *  - fit the IF filter's cutoff and transition under the IF Nyquist frequency
+ *  - keep the IF power, with twice the IF bandwidth, from aliasing into the BB lowpass band
+ *  - fit the BB lowpass filter under the BB Nyquist frequency with enough samples per pulse
+ * The DC removal filter cannot decimate, it passes everything above its cutoff.
+ */
+RatePlan planRates(const std::vector<RateRange>& ranges, const unsigned int& if_bandwidth) {
+	RatePlan best {};
+	int tune_offset = -std::ceil((if_bandwidth/2 + PLAN_DC_GUARD)/PLAN_OFFSET_STEP)*PLAN_OFFSET_STEP;	// Below the signal, as the nominal plan
+	double min_rate = 2.0*(std::abs(tune_offset) + if_bandwidth/2 + IF_FILT_TRANSITION);
+	double min_if_rate = std::max<double>(if_bandwidth + 2*IF_FILT_TRANSITION, if_bandwidth + BB_LP_FILT_CUTOFF + BB_LP_FILT_TRANSITION);
+	double min_bb_rate = std::max<double>(2*(BB_LP_FILT_CUTOFF + BB_LP_FILT_TRANSITION), PLAN_MIN_PULSE_SAMPLES/PULSE_WIDTH);
+
+	auto consider = [&](const unsigned int& samp_rate) {
+		if (samp_rate < min_rate) {
+			return;
+		}
+
+		for (unsigned int if_decimation = 1; if_decimation <= PLAN_MAX_DECIMATION; if_decimation++) {
+			if (samp_rate/if_decimation < min_if_rate) {
+				break;
+			}
+			if (samp_rate % if_decimation) {	// Filters run at whole sample rates
+				continue;
+			}
+
+			for (unsigned int bb_lp_decimation = 1; bb_lp_decimation <= PLAN_MAX_DECIMATION; bb_lp_decimation++) {
+				RatePlan plan {samp_rate, tune_offset, if_decimation, bb_lp_decimation};
+				if (plan.bbRate() < min_bb_rate) {
+					break;
+				}
+				if (plan.ifRate() % (BB_DC_FILT_DECIMATION*bb_lp_decimation)) {
+					continue;
+				}
+
+				plan.cost = planCost(plan);
+				if (!best.samp_rate || (plan.cost < best.cost)) {
+					best = plan;
+				}
+			}
+		}
+	};
+
+	for (const auto& range : ranges) {
+		if (range.minimum >= range.maximum) {	// A single rate
+			consider(std::lround(range.minimum));
+			continue;
+		}
+
+		double first = std::max(std::ceil(range.minimum/PLAN_RATE_STEP)*PLAN_RATE_STEP, std::ceil(min_rate/PLAN_RATE_STEP)*PLAN_RATE_STEP);
+		for (double samp_rate = first; samp_rate <= range.maximum; samp_rate += PLAN_RATE_STEP) {
+			consider(samp_rate);
+		}
+	}
+
+	if (!best.samp_rate) {
+		throw PLAN_NO_RATE;
+	}
+
+	return best;
+}
@@ -0,0 +1,42 @@
+#ifndef SRC_RATEPLANNER_H_
+#define SRC_RATEPLANNER_H_
+
+
+#include <vector>
+
+#define PLAN_DC_GUARD 30e3	// Hz, kept between the DC spike and the edge of the IF band
+#define PLAN_OFFSET_STEP 1000	// Hz, tune offsets are whole multiples of this to keep the IF local oscillator table short
+#define PLAN_RATE_STEP 1000	// Samples/s, continuous sample rate ranges are searched in steps of this
+#define PLAN_MIN_PULSE_SAMPLES 4	// Samples per pulse the receiver needs at the baseband rate
+#define PLAN_MAX_DECIMATION 64
+
+
+enum RatePlanError {PLAN_NO_RATE};
+
+
+/*
+ * Sample rate of the radio, its tuning, and the decimation of each pipeline stage
+ */
+struct RatePlan {
+	unsigned int samp_rate;	// Of the raw samples
+	int tune_offset;	// Hz from SIG_FREQ the radio is tuned to, the IF filter translates it out
+	unsigned int if_decimation;
+	unsigned int bb_lp_decimation;
+	double cost;	// Multiplies per second through the filter chain
+	unsigned int ifRate() const {return samp_rate/if_decimation;};
+	unsigned int bbRate() const;	// At the receiver
+};
+
+
+struct RateRange {
+	double minimum;	// Samples/s, equal for a single supported rate
+	double maximum;
+};
+
+
+RatePlan nominalPlan();	// The compile-time configuration, sample files and tap files are at this rate
+RatePlan planRates(const std::vector<RateRange>& ranges, const unsigned int& if_bandwidth);	// Cheapest workable plan within the ranges
+double planCost(const RatePlan& plan);
+
+
+#endif /* SRC_RATEPLANNER_H_ */
@@ -0,0 +1,30 @@
+#ifndef SRC_SAMPLEFILE_H_
+#define SRC_SAMPLEFILE_H_
+
+
+#include <complex>
+#include <istream>
+
+
+/*
+ * Reads a block of CF32 or CS8 samples from a file as CF32, returns the number of samples read
+ */
+template <size_t N>
+size_t readSamples(std::istream& input, const bool& cs8, std::complex<float> (&buff)[N]) {
+	if (!cs8) {
+		input.read((char *)buff, sizeof(buff));
+		return input.gcount()/sizeof(buff[0]);
+	}
+
+	signed char cs8_buff[N*2];
+	input.read((char *)cs8_buff, sizeof(cs8_buff));
+	size_t num_samples = input.gcount()/2;
+	for (size_t i = 0; i < num_samples; i++) {	// Scale to the CF32 range
+		buff[i] = std::complex<float>(cs8_buff[2*i], cs8_buff[2*i+1])/127.0f;
+	}
+
+	return num_samples;
+}
+
+
+#endif /* SRC_SAMPLEFILE_H_ */
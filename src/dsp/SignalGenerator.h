@@ -2,6 +2,7 @@
 #define SRC_SIGNALGENERATOR_H_
 
 
+#include <cmath>
 #include <memory>
 #include <complex>
 
@@ -12,18 +13,22 @@ enum SignalGeneratorError {INSUFFICIENT_SAMP_RATE, PHASE_DISCONTINUITY};
 template <typename T>
 class SignalGenerator {
 public:
-	SignalGenerator(const unsigned int& samp_rate, const int& freq);
+	SignalGenerator(const unsigned int& samp_rate, const int& freq, const float& phase = 0);	// Phase in radians at step 0
 	T sample();
+	float nextPhase() const;	// Radians, of the sample returned next
 private:
-	T computeSamp(const float& normalized_freq, const unsigned int& step) const;
+	T computeSamp(const float& step_phase) const;
 	unsigned int num_samples {1};
 	std::unique_ptr<T[]> samples;	// Lookup table of signal samples
 	unsigned int cur_step {};
+	float normalized_freq;
+	float phase;
 };
 
 
 template <typename T>
-SignalGenerator<T>::SignalGenerator(const unsigned int& samp_rate, const int& freq) {
+SignalGenerator<T>::SignalGenerator(const unsigned int& samp_rate, const int& freq, const float& phase) :
+		normalized_freq((2*M_PI*freq) / samp_rate), phase(phase) {
 	// Abort if the requested frequency cannot be generated at the specified sample rate
 	if (samp_rate/2 < abs(freq)) {
 		throw INSUFFICIENT_SAMP_RATE;
@@ -42,22 +47,27 @@ SignalGenerator<T>::SignalGenerator(const unsigned int& samp_rate, const int& fr
 	samples = std::make_unique<T[]>(num_samples);
 
 	// Compute samples for lookup table
-	float normalized_freq = (2*M_PI*freq) / samp_rate;
 	for (unsigned int i = 0; i<num_samples; i++) {
-		samples[i] = computeSamp(normalized_freq, i);
+		samples[i] = computeSamp(i * normalized_freq + phase);
 	}
 }
 
 
 template <>
-std::complex<float> SignalGenerator<std::complex<float>>::computeSamp(const float& normalized_freq, const unsigned int& step) const {	// Get the appropriate mixer value for the current sample
-	return std::complex<float>(cos(step * normalized_freq), sin(step * normalized_freq));
+inline std::complex<float> SignalGenerator<std::complex<float>>::computeSamp(const float& step_phase) const {	// Get the appropriate mixer value for the current sample
+	return std::complex<float>(cos(step_phase), sin(step_phase));
 }
 
 
 template <typename T>
-T SignalGenerator<T>::computeSamp(const float& normalized_freq, const unsigned int& step) const {	// Get the appropriate mixer value for the current sample
-	return cos(step * normalized_freq);
+T SignalGenerator<T>::computeSamp(const float& step_phase) const {	// Get the appropriate mixer value for the current sample
+	return cos(step_phase);
+}
+
+
+template <typename T>
+float SignalGenerator<T>::nextPhase() const {
+	return std::fmod(((cur_step+1) % num_samples) * normalized_freq + phase, 2*M_PI);
 }
 
 
@@ -0,0 +1,137 @@
+#include "SpectrumMonitor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <pthread.h>
+#include <sched.h>
+
+
+SpectrumMonitor::SpectrumMonitor(const double& if_rate) :
+		if_rate(if_rate), pool(std::make_unique<SpectrumBlock[]>(SPECTRUM_BLOCKS)), free_blocks(SPECTRUM_BLOCKS), filled(SPECTRUM_BLOCKS) {
+
+	double window_sum = 0;
+	for (unsigned int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+		window[i] = 0.5 - 0.5*std::cos(2*M_PI*i/SPECTRUM_FFT_SIZE);
+		window_sum += window[i];
+	}
+	for (auto& coefficient : window) {
+		coefficient /= window_sum;
+	}
+
+	for (unsigned int i = 0; i < SPECTRUM_FFT_SIZE/2; i++) {
+		twiddles[i] = std::polar<float>(1, -2*M_PI*i/SPECTRUM_FFT_SIZE);
+	}
+
+	for (unsigned int i = 0; i < SPECTRUM_BLOCKS; i++) {
+		free_blocks.push(&pool[i]);
+	}
+
+	monitor_thread = std::thread(&SpectrumMonitor::run, this);
+}
+
+
+SpectrumMonitor::~SpectrumMonitor() {
+	running.store(false, std::memory_order_release);
+	monitor_thread.join();
+}
+
+
+SpectrumStats SpectrumStats::operator-(const SpectrumStats& earlier) const {
+	SpectrumStats period;
+	for (unsigned int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+		period.power[i] = power[i] - earlier.power[i];
+	}
+	period.blocks = blocks - earlier.blocks;
+	period.occupied = occupied - earlier.occupied;
+	period.noise_floor = noise_floor - earlier.noise_floor;
+	period.raw_samples = raw_samples - earlier.raw_samples;
+	period.clipped = clipped - earlier.clipped;
+
+	return period;
+}
+
+
+SpectrumStats SpectrumMonitor::totals() {
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	return stats;
+}
+
+
+void SpectrumMonitor::run() {
+	sched_param param {};	// Only runs when no decode thread wants the CPU
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+	SpectrumBlock* block;
+	while (running.load(std::memory_order_acquire)) {
+		if (filled.pop(block)) {
+			analyse(*block);
+			free_blocks.push(block);
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(SPECTRUM_IDLE_SLEEP));
+		}
+	}
+}
+
+
+/*
+ * Adds a block's power spectrum, and its noise floor unless it holds a burst
+ */
+void SpectrumMonitor::analyse(const SpectrumBlock& block) {
+	std::array<std::complex<float>, SPECTRUM_FFT_SIZE> bins;
+	for (unsigned int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+		bins[i] = block.samples[i]*window[i];
+	}
+	fft(bins);
+
+	std::array<float, SPECTRUM_FFT_SIZE> power;
+	for (unsigned int i = 0; i < SPECTRUM_FFT_SIZE; i++) {	// Negative frequencies first
+		power[i] = std::norm(bins[(i + SPECTRUM_FFT_SIZE/2) % SPECTRUM_FFT_SIZE]);
+	}
+
+	auto sorted = power;
+	std::nth_element(sorted.begin(), sorted.begin() + SPECTRUM_FFT_SIZE/2, sorted.end());
+	float median = sorted[SPECTRUM_FFT_SIZE/2];
+	bool occupied = *std::max_element(power.begin(), power.end()) > median*std::pow(10.0f, SPECTRUM_BURST_DB/10.0f);
+
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	for (unsigned int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+		stats.power[i] += power[i];
+	}
+	stats.blocks++;
+	if (occupied) {
+		stats.occupied++;
+	} else {
+		stats.noise_floor += median;
+	}
+	stats.raw_samples += block.raw_samples;
+	stats.clipped += block.clipped;
+}
+
+
+/*
+ * In-place iterative radix-2 decimation-in-time FFT
+ */
+void SpectrumMonitor::fft(std::array<std::complex<float>, SPECTRUM_FFT_SIZE>& bins) const {
+	for (unsigned int i = 1, j = 0; i < SPECTRUM_FFT_SIZE; i++) {	// Bit-reversed order
+		unsigned int bit = SPECTRUM_FFT_SIZE >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			std::swap(bins[i], bins[j]);
+		}
+	}
+
+	for (unsigned int len = 2; len <= SPECTRUM_FFT_SIZE; len <<= 1) {
+		unsigned int stride = SPECTRUM_FFT_SIZE/len;
+		for (unsigned int start = 0; start < SPECTRUM_FFT_SIZE; start += len) {
+			for (unsigned int k = 0; k < len/2; k++) {
+				auto odd = bins[start + k + len/2]*twiddles[k*stride];
+				bins[start + k + len/2] = bins[start + k] - odd;
+				bins[start + k] += odd;
+			}
+		}
+	}
+}
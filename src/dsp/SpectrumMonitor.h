@@ -0,0 +1,95 @@
+#ifndef SRC_SPECTRUMMONITOR_H_
+#define SRC_SPECTRUMMONITOR_H_
+
+
+#include "../util/BoundedQueue.h"
+
+#include <array>
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#define SPECTRUM_FFT_SIZE 256	// IF samples per block, a power of two
+#define SPECTRUM_BLOCK_INTERVAL 16	// One in this many blocks of IF samples is analysed
+#define SPECTRUM_BLOCKS 4	// Blocks in flight between the pipeline and the monitor thread
+#define SPECTRUM_IDLE_SLEEP 50	// Milliseconds the monitor thread sleeps when there is nothing to analyse
+#define SPECTRUM_BURST_DB 15	// A block is occupied when its strongest bin is this far above its median bin
+#define SPECTRUM_CLIP_LEVEL 0.99	// Raw I or Q magnitude counted as clipped, full scale is 1
+#define SPECTRUM_REPORT_BANDS 16	// Bands the averaged spectrum is reported in
+
+
+/*
+ * IF samples of one analysed block, with the clipping of the raw samples they were filtered from
+ */
+struct SpectrumBlock {
+	std::array<std::complex<float>, SPECTRUM_FFT_SIZE> samples;
+	unsigned int raw_samples;	// Not counted when decoding from a tap file
+	unsigned int clipped;
+};
+
+
+/*
+ * Spectrum statistics accumulated since the monitor started, subtract an earlier copy for a period
+ */
+struct SpectrumStats {
+	SpectrumStats operator-(const SpectrumStats& earlier) const;
+	std::array<double, SPECTRUM_FFT_SIZE> power {};	// Summed over blocks per bin, lowest frequency first, full-scale tone is 1
+	unsigned long long int blocks {};
+	unsigned long long int occupied {};	// Blocks with a burst in them
+	double noise_floor {};	// Median bin power, summed over unoccupied blocks
+	unsigned long long int raw_samples {};
+	unsigned long long int clipped {};
+};
+
+
+/*
+ * Side channel of one pipeline for telling interference, saturation and silence apart. The pipeline
+ * hands every SPECTRUM_BLOCK_INTERVAL-th block of IF filter output to a separate idle-priority thread,
+ * which takes its Hann-windowed FFT. Blocks are recycled through a fixed pool, so the decode path
+ * never allocates or waits, and a block is skipped if the monitor has none free. Its cost is bounded
+ * by the interval, and the thread only runs on otherwise idle CPU time.
+ */
+class SpectrumMonitor {
+public:
+	SpectrumMonitor(const double& if_rate);
+	~SpectrumMonitor();
+	SpectrumBlock* acquire();	// Called from the decode path, nullptr if none are free
+	void submit(SpectrumBlock* block) {filled.push(block);};	// Called from the decode path, for a block from acquire()
+	SpectrumStats totals();	// Any thread
+	double getIFRate() const {return if_rate;};
+	unsigned long long int getSkipped() const {return skipped.load(std::memory_order_relaxed);};	// Blocks skipped with none free
+private:
+	void run();
+	void analyse(const SpectrumBlock& block);
+	void fft(std::array<std::complex<float>, SPECTRUM_FFT_SIZE>& bins) const;
+	const double if_rate;
+	std::array<float, SPECTRUM_FFT_SIZE> window;	// Hann, scaled so a full-scale tone has power 1
+	std::array<std::complex<float>, SPECTRUM_FFT_SIZE/2> twiddles;
+	std::unique_ptr<SpectrumBlock[]> pool;
+	BoundedQueue<SpectrumBlock*> free_blocks;
+	BoundedQueue<SpectrumBlock*> filled;
+	std::atomic<unsigned long long int> skipped {0};
+	std::mutex stats_mutex;	// Monitor thread and totals() only, never the decode path
+	SpectrumStats stats;
+	std::atomic<bool> running {true};
+	std::thread monitor_thread;
+};
+
+
+inline SpectrumBlock* SpectrumMonitor::acquire() {
+	SpectrumBlock* block;
+	if (!free_blocks.pop(block)) {
+		skipped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	block->raw_samples = 0;
+	block->clipped = 0;
+
+	return block;
+}
+
+
+#endif /* SRC_SPECTRUMMONITOR_H_ */
@@ -0,0 +1,71 @@
+#include "StageTap.h"
+#include "DecodePipeline.h"
+
+#include <cstring>
+
+
+StageTap::StageTap(const std::string& path, const TapStage& stage) : stage(stage), buffer(std::make_unique<char[]>(TAP_BUFFER_SIZE)) {
+	output.rdbuf()->pubsetbuf(buffer.get(), TAP_BUFFER_SIZE);
+	output.open(path, std::ios::out | std::ios::binary);
+	if (!output) {
+		throw TAP_OPEN_FAILED;
+	}
+}
+
+
+StageTap::~StageTap() {
+	output.close();	// Flush before the buffer is freed
+}
+
+
+void StageTap::start(const long long int& start_time, const RatePlan& plan, const int& if_offset, const unsigned int& if_cutoff,
+		const unsigned int& if_taps) {
+	TapHeader header {};
+	std::memcpy(header.magic, TAP_MAGIC, sizeof(header.magic));
+	header.stage = stage;
+	header.start_time = start_time;
+	header.input_rate = plan.samp_rate;
+	header.sample_rate = plan.ifRate();
+	header.tune_offset = plan.tune_offset - if_offset;
+	header.if_cutoff = if_cutoff;
+	header.if_transition = IF_FILT_TRANSITION;
+	header.if_attenuation = FILT_ATTENUATION;
+	header.if_decimation = plan.if_decimation;
+	header.if_taps = if_taps;
+
+	output.write((const char*)&header, sizeof(header));
+	header_written = true;
+}
+
+
+bool isTapFile(std::istream& input) {
+	char magic[sizeof(TapHeader::magic)] {};
+	input.read(magic, sizeof(magic));
+	bool tap_file = (input.gcount() == sizeof(magic)) && !std::memcmp(magic, TAP_MAGIC, sizeof(magic));
+
+	input.clear();
+	input.seekg(0);
+	return tap_file;
+}
+
+
+TapHeader readTapHeader(std::istream& input) {
+	TapHeader header {};
+	if (!input.read((char*)&header, sizeof(header)) || std::memcmp(header.magic, TAP_MAGIC, sizeof(header.magic)) || (header.stage > TAP_BB)) {
+		throw TAP_HEADER_INVALID;
+	}
+	if ((header.input_rate != SAMP_RATE) || (header.if_decimation != IF_FILT_DECIMATION)) {	// The rest of the chain would run at the wrong rate
+		throw TAP_RATE_MISMATCH;
+	}
+
+	return header;
+}
+
+
+/*
+ * The tune offset is not compared, AFC retunes the IF filter to follow the carrier
+ */
+bool tapFiltersMatch(const TapHeader& header, const unsigned int& if_cutoff, const unsigned int& if_taps) {
+	return (header.if_cutoff == if_cutoff) && (header.if_transition == IF_FILT_TRANSITION)
+			&& (header.if_attenuation == FILT_ATTENUATION) && (header.if_taps == if_taps);
+}
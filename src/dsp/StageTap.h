@@ -0,0 +1,69 @@
+#ifndef SRC_STAGETAP_H_
+#define SRC_STAGETAP_H_
+
+
+#include "RatePlanner.h"
+
+#include <complex>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <string>
+
+#define TAP_MAGIC "S345TAP1"	// Leads a tap file, followed by a TapHeader and the samples
+#define TAP_BUFFER_SIZE (1<<20)	// Bytes buffered before each write to the tap file
+
+
+enum TapStage {TAP_IF, TAP_BB};	// IF filter output as CF32, or its power (before DC removal) as F32, both at the IF rate
+enum TapError {TAP_OPEN_FAILED, TAP_HEADER_INVALID, TAP_RATE_MISMATCH};
+
+
+/*
+ * Describes the samples of a tap file and the front end that produced them, native (little-endian) byte order
+ */
+struct TapHeader {
+	char magic[8];
+	uint8_t stage;	// TapStage
+	uint8_t reserved[7];
+	int64_t start_time;	// Of the first sample, ns since the Unix epoch
+	double input_rate;	// Of the raw samples, samples/s
+	double sample_rate;	// Of the tapped samples
+	double tune_offset;	// Hz, translated out by the IF filter when it started
+	double if_cutoff;	// IF filter, Hz
+	double if_transition;
+	double if_attenuation;	// dB
+	uint32_t if_decimation;
+	uint32_t if_taps;
+};
+static_assert(sizeof(TapHeader) == 80, "TapHeader layout must not contain padding");
+
+
+/*
+ * Saves the samples leaving one stage of a pipeline, so decoding can later resume from that stage
+ * without repeating the IF filter. Written on the pipeline's thread, through a large buffer.
+ */
+class StageTap {
+public:
+	StageTap(const std::string& path, const TapStage& stage);
+	~StageTap();
+	TapStage getStage() const {return stage;};
+	bool started() const {return header_written;};
+	void start(const long long int& start_time, const RatePlan& plan, const int& if_offset, const unsigned int& if_cutoff,
+			const unsigned int& if_taps);	// Writes the header, before the first sample
+	void write(const std::complex<float>& sample) {output.write((const char*)&sample, sizeof(sample));};
+	void write(const float& sample) {output.write((const char*)&sample, sizeof(sample));};
+private:
+	const TapStage stage;
+	std::unique_ptr<char[]> buffer;
+	std::ofstream output;
+	bool header_written {false};
+};
+
+
+bool isTapFile(std::istream& input);	// Leaves the input at its start
+TapHeader readTapHeader(std::istream& input);	// Validates the header against this build's sample rates
+bool tapFiltersMatch(const TapHeader& header, const unsigned int& if_cutoff, const unsigned int& if_taps);	// False if the IF filter differs from the pipeline's
+
+
+#endif /* SRC_STAGETAP_H_ */
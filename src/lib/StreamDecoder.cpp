@@ -0,0 +1,33 @@
+#include "StreamDecoder.h"
+
+
+StreamDecoder::StreamDecoder(EventSink* event_sink, const StreamConfig& config) :
+		state_store(config.state_dir.empty() ? nullptr : std::make_unique<StateStore>(config.state_dir)),
+		pipeline(config.receiver, event_sink, config.if_bandwidth, config.plan),
+		frame_dedup(event_sink, config.dedup_window),
+		sensor_tracker(event_sink, state_store.get()) {
+
+	if (config.afc) {
+		pipeline.enableAFC();
+	}
+}
+
+
+void StreamDecoder::finish() {
+	if (finished) {
+		return;
+	}
+	finished = true;
+	frame_dedup.flush();	// Before the tracker's summary
+	sensor_tracker.finish();
+}
+
+
+void StreamDecoder::track(std::shared_ptr<SensorMessage> sensor_message) {
+	auto event_message = frame_dedup.push(sensor_message);
+	if (event_message) {	// SensorTracker gets one message per event from FrameDeduplicator
+		sensor_tracker.push(std::move(event_message));
+	} else if (sensor_message) {	// and each repeat confirms the sensor
+		sensor_tracker.confirm(sensor_message->getTXID());
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef SRC_STREAMDECODER_H_
+#define SRC_STREAMDECODER_H_
+
+
+#include "../dsp/DecodePipeline.h"
+#include "../dsp/RatePlanner.h"
+#include "../tracking/FrameDeduplicator.h"
+#include "../tracking/SensorTracker.h"
+#include "../tracking/StateStore.h"
+#include "../output/OutputEvent.h"
+
+#include <complex>
+#include <memory>
+#include <string>
+
+#define STREAM_CS8_BLOCK 4096	// Samples converted from CS8 at a time
+
+
+struct StreamConfig {
+	unsigned char receiver {0};	// Reported with each message
+	unsigned int if_bandwidth = SENSOR_BW;	// Hz
+	bool afc {false};
+	RatePlan plan {nominalPlan()};	// The samples must be at plan.samp_rate, tuned to SIG_FREQ + plan.tune_offset
+	std::string state_dir;	// Empty to keep sensor state in memory only
+	double dedup_window {DEDUP_WINDOW};	// Seconds
+};
+
+
+/*
+ * One sample stream decoded in-process: the DecodePipeline filter chain and receivers, FrameDeduplicator
+ * and SensorTracker as the Soapy345 executable runs them, without threads or console I/O.
+ * Samples are decoded on the caller's thread as blocks are pushed. Events go to the EventSink as
+ * they are produced, and each frame that passed its CRC is passed to the push() callback before tracking.
+ * The summary is reported by finish(), or on destruction.
+ */
+class StreamDecoder {
+public:
+	StreamDecoder(EventSink* event_sink, const StreamConfig& config = StreamConfig());	// Throws StoreError
+	~StreamDecoder() {finish();};
+	void finish();	// Reports repeats still open and the sensor summary and saves the final state, no samples may be pushed afterwards
+	bool isFinished() const {return finished;};
+	template <typename FUNC>
+	void push(const std::complex<float>* samples, const size_t& num_samples, FUNC func);	// Calls func(message) for each decoded frame
+	void push(const std::complex<float>* samples, const size_t& num_samples) {push(samples, num_samples, [](const std::shared_ptr<SensorMessage>&) {});};
+	template <typename FUNC>
+	void pushCS8(const signed char* samples, const size_t& num_samples, FUNC func);	// Interleaved I and Q, num_samples pairs
+	void setTime(const long long int& time) {pipeline.setTime(time);};	// Time of the next sample pushed, ns since the Unix epoch
+	void addDecoder(std::unique_ptr<ProtocolDecoder> decoder) {pipeline.addDecoder(std::move(decoder));};	// Before samples are pushed
+	size_t size() const {return sensor_tracker.size();};	// Sensors tracked
+	const DecodePipeline& getPipeline() const {return pipeline;};
+private:
+	void track(std::shared_ptr<SensorMessage> sensor_message);
+	std::unique_ptr<StateStore> state_store;	// Outlives the tracker, which saves to it on destruction
+	DecodePipeline pipeline;
+	FrameDeduplicator frame_dedup;
+	SensorTracker sensor_tracker;
+	bool finished {false};
+};
+
+
+template <typename FUNC>
+void StreamDecoder::push(const std::complex<float>* samples, const size_t& num_samples, FUNC func) {
+	pipeline.push(samples, num_samples, [&](std::shared_ptr<SensorMessage> sensor_message) {
+		func(sensor_message);
+		track(std::move(sensor_message));
+	});
+}
+
+
+template <typename FUNC>
+void StreamDecoder::pushCS8(const signed char* samples, const size_t& num_samples, FUNC func) {
+	std::complex<float> buff[STREAM_CS8_BLOCK];
+	for (size_t start = 0; start < num_samples; start += STREAM_CS8_BLOCK) {
+		size_t block_size = std::min<size_t>(STREAM_CS8_BLOCK, num_samples-start);
+		for (size_t i = 0; i < block_size; i++) {	// Scaled as readSamples() reads CS8 files
+			buff[i] = std::complex<float>(samples[2*(start+i)], samples[2*(start+i)+1])/127.0f;
+		}
+
+		push(buff, block_size, func);
+	}
+}
+
+
+#endif /* SRC_STREAMDECODER_H_ */
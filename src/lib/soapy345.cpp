@@ -0,0 +1,230 @@
+#include "soapy345.h"
+#include "StreamDecoder.h"
+#include "../util/BoundedQueue.h"
+
+#include <atomic>
+#include <complex>
+#include <deque>
+#include <mutex>
+
+
+static_assert((int)SOAPY345_STORE_FAILED == (int)STORE_FAILED, "soapy345_event_type must match EventType");
+static_assert((int)SOAPY345_VIVINT_INIT == (int)VIVINT_INIT, "soapy345_vendor must match Vendor");
+
+
+/*
+ * Passes events to the caller's callback, or holds them in a ring for soapy345_poll(). Events that
+ * must not be dropped, such as the summary, overflow a full ring into a list until they are polled.
+ */
+class CallbackSink : public EventSink {
+public:
+	CallbackSink(const soapy345_config& config) : on_event(config.on_event), user(config.user), ring(config.on_event ? 1 : config.ring_size) {};
+	void emit(const OutputEvent& event) override {hold(event, false);};
+	void emitBlocking(const OutputEvent& event) override {hold(event, true);};
+	size_t poll(soapy345_event* events, const size_t& max_events);
+	unsigned long long int getDropped() const {return dropped.load(std::memory_order_relaxed);};
+private:
+	void hold(const OutputEvent& event, const bool& blocking);
+	const soapy345_event_callback on_event;
+	void* const user;
+	BoundedQueue<soapy345_event> ring;
+	std::mutex overflow_mutex;
+	std::deque<soapy345_event> overflow;	// Newer than any event in the ring
+	std::atomic<bool> overflowing {false};	// The ring is bypassed until the overflow is polled, to keep events in order
+	std::atomic<unsigned long long int> dropped {0};
+};
+
+
+void CallbackSink::hold(const OutputEvent& event, const bool& blocking) {
+	soapy345_event c_event {};
+	c_event.type = event.type;
+	c_event.vendor = event.vendor;
+	c_event.devid = event.devid;
+	c_event.former_state = event.former_state;
+	c_event.sensor_state = event.sensor_state;
+	c_event.receiver = event.receiver;
+	c_event.rx_crc = event.rx_crc;
+	c_event.calc_crc = event.calc_crc;
+	c_event.count = event.count;
+	c_event.rssi = event.rssi;
+	c_event.freq_offset = event.freq_offset;
+	c_event.txid = event.txid;
+	c_event.time = event.time;
+	c_event.data = event.data;
+	c_event.repeat_count = event.repeat_count;
+	c_event.manchester_errors = event.manchester_errors;
+
+	if (on_event) {
+		on_event(user, &c_event);
+	} else if (overflowing.load(std::memory_order_acquire) || !ring.push(c_event)) {
+		if (!blocking) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(overflow_mutex);
+		overflow.push_back(c_event);
+		overflowing.store(true, std::memory_order_release);
+	}
+}
+
+
+size_t CallbackSink::poll(soapy345_event* events, const size_t& max_events) {
+	size_t taken = 0;
+	while ((taken < max_events) && ring.pop(events[taken])) {
+		taken++;
+	}
+
+	if ((taken < max_events) && overflowing.load(std::memory_order_acquire)) {	// The ring is empty, its overflow is next
+		std::lock_guard<std::mutex> lock(overflow_mutex);
+		while ((taken < max_events) && !overflow.empty()) {
+			events[taken++] = overflow.front();
+			overflow.pop_front();
+		}
+		overflowing.store(!overflow.empty(), std::memory_order_release);
+	}
+
+	return taken;
+}
+
+
+struct soapy345_decoder {
+	soapy345_decoder(const soapy345_config& config, const StreamConfig& stream_config) :
+			sink(config), decoder(&sink, stream_config), on_frame(config.on_frame), user(config.user) {};
+	void frame(const std::shared_ptr<SensorMessage>& sensor_message) const;
+	CallbackSink sink;	// Outlives the decoder, which reports its summary on destruction
+	StreamDecoder decoder;
+	const soapy345_frame_callback on_frame;
+	void* const user;
+};
+
+
+void soapy345_decoder::frame(const std::shared_ptr<SensorMessage>& sensor_message) const {
+	if (!on_frame) {
+		return;
+	}
+
+	soapy345_frame c_frame {};
+	c_frame.vendor = sensor_message->getVendor();
+	c_frame.devid = sensor_message->getDEVID();
+	c_frame.sensor_state = sensor_message->getState();
+	c_frame.receiver = sensor_message->getReceiver();
+	c_frame.manchester_errors = sensor_message->getManchesterErrors();
+	c_frame.header = sensor_message->getHeader();
+	c_frame.txid = sensor_message->getTXID();
+	c_frame.rssi = sensor_message->getRSSI();
+	c_frame.freq_offset = sensor_message->getFreqOffset();
+	c_frame.time = sensor_message->getTime();
+	on_frame(user, &c_frame);
+}
+
+
+void soapy345_default_config(soapy345_config* config) {
+	*config = soapy345_config {};
+	config->samp_rate = SAMP_RATE;
+	config->if_bandwidth = SENSOR_BW;
+	config->ring_size = SOAPY345_RING_SIZE;
+}
+
+
+/*
+ * Exceptions stop here, C callers get NULL or -1 instead
+ */
+soapy345_decoder* soapy345_create(const soapy345_config* config) {
+	soapy345_config defaults;
+	soapy345_default_config(&defaults);
+	if (!config) {
+		config = &defaults;
+	}
+
+	StreamConfig stream_config;
+	stream_config.receiver = config->receiver;
+	stream_config.if_bandwidth = config->if_bandwidth;
+	stream_config.afc = config->afc;
+	if (config->state_dir) {
+		stream_config.state_dir = config->state_dir;
+	}
+
+	try {
+		if (config->samp_rate != SAMP_RATE) {	// At the nominal rate, recordings made by Soapy345 can be pushed
+			stream_config.plan = planRates({{(double)config->samp_rate, (double)config->samp_rate}}, config->if_bandwidth);
+		}
+
+		return new soapy345_decoder(*config, stream_config);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+
+int soapy345_finish(soapy345_decoder* decoder) {
+	try {
+		decoder->decoder.finish();
+	} catch (...) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+void soapy345_destroy(soapy345_decoder* decoder) {
+	soapy345_finish(decoder);	// Only does anything if it was not called, the destructors are then left with nothing to throw on
+	delete decoder;
+}
+
+
+double soapy345_tune_frequency(const soapy345_decoder* decoder) {
+	return SIG_FREQ + decoder->decoder.getPipeline().getPlan().tune_offset;
+}
+
+
+void soapy345_set_time(soapy345_decoder* decoder, int64_t time) {
+	decoder->decoder.setTime(time);
+}
+
+
+int soapy345_push_cf32(soapy345_decoder* decoder, const float* samples, size_t num_samples) {
+	if (decoder->decoder.isFinished()) {
+		return -1;
+	}
+
+	try {
+		decoder->decoder.push(reinterpret_cast<const std::complex<float>*>(samples), num_samples,
+				[decoder](const std::shared_ptr<SensorMessage>& sensor_message) {decoder->frame(sensor_message);});
+	} catch (...) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int soapy345_push_cs8(soapy345_decoder* decoder, const int8_t* samples, size_t num_samples) {
+	if (decoder->decoder.isFinished()) {
+		return -1;
+	}
+
+	try {
+		decoder->decoder.pushCS8(reinterpret_cast<const signed char*>(samples), num_samples,
+				[decoder](const std::shared_ptr<SensorMessage>& sensor_message) {decoder->frame(sensor_message);});
+	} catch (...) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+size_t soapy345_poll(soapy345_decoder* decoder, soapy345_event* events, size_t max_events) {
+	return decoder->sink.poll(events, max_events);
+}
+
+
+uint64_t soapy345_dropped_events(const soapy345_decoder* decoder) {
+	return decoder->sink.getDropped();
+}
+
+
+size_t soapy345_sensor_count(const soapy345_decoder* decoder) {
+	return decoder->decoder.size();
+}
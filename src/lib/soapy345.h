@@ -0,0 +1,114 @@
+#ifndef SOAPY345_H_
+#define SOAPY345_H_
+
+/*
+ * C interface of libsoapy345, the Soapy345 decoder and sensor tracker hosted in-process.
+ * Each decoder takes one stream of IQ samples, pushed in blocks of any size on one thread at a time.
+ * Nothing is written to the console. See src/lib/StreamDecoder.h for the C++ interface.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SOAPY345_RING_SIZE 1024	/* Default events held for soapy345_poll() */
+
+
+/* Same values as EventType in src/output/OutputEvent.h */
+enum soapy345_event_type {
+	SOAPY345_SENSOR_ADD,	/* New sensor: txid, vendor, devid, sensor_state, time, receiver, rssi (of the first copy) */
+	SOAPY345_SENSOR_UPDATE,	/* Sensor seen again: txid, vendor, count, former_state, sensor_state, time, receiver, rssi (of the first copy) */
+	SOAPY345_SENSOR_EVICT,	/* Stale sensor removed from tracking: txid, vendor, followed by its summary */
+	SOAPY345_SUMMARY_BEGIN,	/* Start of the sensor summary, from soapy345_finish(): count (number of sensors) */
+	SOAPY345_SUMMARY_SENSOR,	/* Start of one sensor's history: txid, vendor, count, data (changes not retained) */
+	SOAPY345_SUMMARY_CHANGE,	/* One state change in a sensor's history: former_state, sensor_state, time */
+	SOAPY345_SUMMARY_SENSOR_END,	/* End of one sensor's history */
+	SOAPY345_CRC_FAIL,	/* Frame failed CRC check: vendor, data, count (data bits), rx_crc, calc_crc */
+	SOAPY345_RAW_FRAME,	/* Raw frame dump for vendors that are not fully understood: vendor, data, count (data bits) */
+	SOAPY345_UNKNOWN_CHANNEL,	/* Frame on a channel with no known vendor: count (channel) */
+	SOAPY345_SENSOR_REPEATS,	/* Copies of a reported frame, once no more arrived for the dedup window: txid, vendor, sensor_state,
+				   time (last copy), repeat_count, manchester_errors, receiver, rssi, freq_offset (strongest copy) */
+	SOAPY345_STORE_FAILED	/* Sensor state could not be saved to state_dir, tracking carries on in memory only: count (error) */
+};
+
+/* Same values as Vendor in src/messaging/FrameLayout.h */
+enum soapy345_vendor {SOAPY345_UNKNOWN, SOAPY345_HONEYWELL, SOAPY345_TWOGIG, SOAPY345_VIVINT, SOAPY345_VIVINT_INIT};
+
+
+/* Sensor state change or other report, fields are zero unless listed for the type */
+typedef struct soapy345_event {
+	uint8_t type;	/* soapy345_event_type */
+	uint8_t vendor;	/* soapy345_vendor */
+	uint8_t devid;
+	uint8_t former_state;
+	uint8_t sensor_state;
+	uint8_t receiver;
+	uint16_t rx_crc;
+	uint16_t calc_crc;
+	uint32_t count;
+	float rssi;	/* dBFS */
+	float freq_offset;	/* Hz from 345.006 MHz, NAN when not measured */
+	uint64_t txid;
+	int64_t time;	/* ns since the Unix epoch, from the sample clock for message events */
+	uint64_t data;
+	uint32_t repeat_count;	/* Copies of the frame received */
+	uint32_t manchester_errors;	/* Skipped Manchester sequences of the best copy, fewer is better */
+} soapy345_event;
+
+/* Frame that passed its CRC, before repeats are collapsed */
+typedef struct soapy345_frame {
+	uint8_t vendor;	/* soapy345_vendor */
+	uint8_t devid;
+	uint8_t sensor_state;
+	uint8_t receiver;
+	uint32_t manchester_errors;	/* Skipped Manchester sequences, fewer is better */
+	uint64_t header;
+	uint64_t txid;
+	float rssi;	/* dBFS */
+	float freq_offset;	/* Hz from 345.006 MHz, NAN when not measured */
+	int64_t time;	/* When the frame's sync sequence ended, ns since the Unix epoch */
+} soapy345_frame;
+
+/* Called on the pushing thread, the pointer is only valid during the call */
+typedef void (*soapy345_event_callback)(void* user, const soapy345_event* event);
+typedef void (*soapy345_frame_callback)(void* user, const soapy345_frame* frame);
+
+typedef struct soapy345_config {
+	soapy345_event_callback on_event;	/* NULL to hold events for soapy345_poll() */
+	soapy345_frame_callback on_frame;	/* NULL if frames are not wanted */
+	void* user;	/* Passed to the callbacks */
+	uint32_t samp_rate;	/* Samples per second, the filter decimations are planned for it. At 250000 the
+				   nominal tuning is kept, so recordings made by Soapy345 can be pushed */
+	uint32_t if_bandwidth;	/* Hz */
+	int afc;	/* Non-zero to follow the carrier offset */
+	const char* state_dir;	/* NULL to keep sensor state in memory only */
+	uint8_t receiver;	/* Reported with each frame */
+	uint32_t ring_size;	/* Events held for soapy345_poll() */
+} soapy345_config;
+
+typedef struct soapy345_decoder soapy345_decoder;
+
+
+void soapy345_default_config(soapy345_config* config);	/* 250 kS/s, 40 kHz IF, no AFC, events held for polling */
+soapy345_decoder* soapy345_create(const soapy345_config* config);	/* NULL if the rate cannot be decoded or state_dir is unusable */
+int soapy345_finish(soapy345_decoder* decoder);	/* Reports repeats still open and the sensor summary, and saves the final state.
+				   Poll for them afterwards, they are held even if the ring is full. No samples may be pushed
+				   afterwards. 0 on success */
+void soapy345_destroy(soapy345_decoder* decoder);	/* Calls soapy345_finish() if it was not called, events still held are lost */
+double soapy345_tune_frequency(const soapy345_decoder* decoder);	/* Hz, the samples must be centred here */
+void soapy345_set_time(soapy345_decoder* decoder, int64_t time);	/* Of the next sample pushed, ns since the Unix epoch */
+int soapy345_push_cf32(soapy345_decoder* decoder, const float* samples, size_t num_samples);	/* Interleaved I and Q, 0 on success */
+int soapy345_push_cs8(soapy345_decoder* decoder, const int8_t* samples, size_t num_samples);	/* Interleaved I and Q, 0 on success */
+size_t soapy345_poll(soapy345_decoder* decoder, soapy345_event* events, size_t max_events);	/* Any thread, returns the number taken */
+uint64_t soapy345_dropped_events(const soapy345_decoder* decoder);	/* Events lost to a full ring, summary, eviction and store failure events are held instead */
+size_t soapy345_sensor_count(const soapy345_decoder* decoder);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOAPY345_H_ */
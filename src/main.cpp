@@ -4,37 +4,35 @@
 #include <SoapySDR/Types.hpp>
 #include <SoapySDR/Formats.hpp>
 
-#include "dsp/Filter.h"
-#include "messaging/SensorMessageReceiver.h"
+#include "dsp/DecodePipeline.h"
+#include "dsp/GainController.h"
+#include "dsp/SampleFile.h"
+#include "batch/BatchProcessor.h"
+#include "tracking/FrameDeduplicator.h"
 #include "tracking/SensorTracker.h"
+#include "query/QueryServer.h"
+#include "output/EventWriter.h"
+#include "output/StatsReporter.h"
+#include "output/CaptureWriter.h"
+#include "messaging/FrameBus.h"
 
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <complex>
 #include <cstring>
+#include <chrono>
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <optional>
 
 
 #define RX_BUF_SIZE 1024
-
-#define SAMP_RATE 250e3
-#define SIG_FREQ 345006e3
-#define TUNE_FREQ_OFFSET -70e3	// Space the DC spike well away from the signal
-#define SENSOR_BW 40e3
-#define PULSE_WIDTH 130e-6	// 130 us
-
-#define FILT_ATTENUATION 3	// dB
-
-#define IF_FILT_TRANSITION 2500
-#define IF_FILT_DECIMATION 4
-
-#define BB_DC_FILT_CUTOFF 1530
-#define BB_DC_FILT_TRANSITION 450
-#define BB_DC_FILT_DECIMATION 1
-
-#define BB_LP_FILT_CUTOFF 9800
-#define BB_LP_FILT_TRANSITION 1400
-#define BB_LP_FILT_DECIMATION 2
+#define TRACKER_IDLE_WAIT 100	// Milliseconds the tracker waits for frames before ticking, it is woken when one arrives
+#define REPLAY_BUFFER_BLOCKS 16	// Blocks a radio buffers before it overflows, replay drops samples when it falls further behind
 
 using std::cout;
 using std::cerr;
@@ -47,13 +45,48 @@ using std::ifstream;
 using std::complex;
 
 
-bool not_terminated = true;
+std::atomic<bool> not_terminated {true};
+std::atomic<bool> dump_latency {false};	// Set by SIGUSR1
+
+
+/*
+ * Block timing of a paced file replay, written by the replay thread and read once it has finished
+ */
+struct ReplayStats {
+	unsigned long long int samples {};	// Processed
+	unsigned long long int dropped_blocks {};	// Skipped on would-be overflows
+	long long int busy_ns {};	// Spent processing blocks
+	long long int peak_block_ns {};
+};
 
 
 void printHelp(char* command) {
-	cerr << "Usage:" << endl << command << " [INPUT FILE]" << endl << endl;
-	cerr << "INPUT FILE: Optional stream of CF32 (complex floating point) values, compatible with GNU Radio File Source/Sink blocks. "
-			"When not specified, SDR hardware is used by default." << endl;
+	cerr << "Usage:" << endl << command << " [OPTIONS] [INPUT FILE]" << endl << endl;
+	cerr << "INPUT FILE: Optional stream of CF32 (complex floating point) or CS8 (see --input-format) values, compatible with GNU Radio File Source/Sink blocks. "
+			"When not specified, SDR hardware is used by default." << endl << endl;
+	cerr << "OPTIONS:" << endl;
+	cerr << "--format text|json|binary: Sensor report format, human readable text (default), JSON lines, or fixed-size binary records." << endl;
+	cerr << "--input-format cf32|cs8: Sample format of INPUT FILE, complex float (default) or complex signed 8-bit." << endl;
+	cerr << "--replay SPEED: Feed INPUT FILE at SPEED times the sample rate, 1 for real time, through the same threads as SDR input. "
+			"Reports the real-time factor, peak block processing time, and overflows a radio would have had." << endl;
+	cerr << "--batch DIRECTORY|PATTERN: Decode every file in DIRECTORY (and its subdirectories) or matching the glob PATTERN in parallel, "
+			"then write each file's sensors and a merge of all of them to stdout as JSON lines. Other options except --input-format are ignored." << endl;
+	cerr << "--threads N: Worker threads for --batch, default one per core." << endl;
+	cerr << "--capture-dir DIRECTORY: Save the raw IQ around triggering frames to DIRECTORY, as CS8 files with JSON descriptions." << endl;
+	cerr << "--capture-on sync|pass|fail[,...]: Frames that trigger a capture, every frame that synced, or that passed or failed the CRC. Default fail." << endl;
+	cerr << "--tap if|bb FILE: Save the IF filter output (CF32), or its power (F32), to FILE at " << SAMP_RATE/IF_FILT_DECIMATION << " samples/s. "
+			"Given as INPUT FILE, a tap file is decoded from that stage on, skipping the IF filter." << endl;
+	cerr << "--if-bw HZ: Bandwidth of the IF filter, default " << SENSOR_BW << ". Narrower rejects more noise, but needs the carrier close to " << SIG_FREQ << " Hz or --afc." << endl;
+	cerr << "--afc: Track the carrier offset of each sensor from its passed frames, and centre the IF filter on them. The filter is narrowed towards --if-bw as far as the spread of the offsets allows." << endl;
+	cerr << "--fixed-rate: Receive at " << SAMP_RATE << " samples/s rather than the cheapest rate the device supports. Always used with --capture-dir and --tap." << endl;
+	cerr << "--state-dir DIRECTORY: Persist sensor state in DIRECTORY and restore it on startup." << endl;
+	cerr << "--devices all|INDEX[,INDEX...]: SDR devices to receive with, by enumeration index. Each device is decoded on its own thread. Default all." << endl;
+	cerr << "--frame-policy drop-oldest|block: When the tracker falls behind the decoder threads, drop the oldest decoded frames (default), or have the decoders wait." << endl;
+	cerr << "--query-socket PATH: Serve live sensor state queries over a Unix-domain socket at PATH." << endl;
+	cerr << "--stats: Report per-stage throughput and CPU time, frame counters, and stream errors to stderr every " << STATS_PERIOD << " seconds and at exit." << endl;
+	cerr << "--spectrum: Analyse the IF spectrum on an idle-priority thread, adding its noise floor, burst occupancy, clipping and mean power by band to the --stats report." << endl;
+	cerr << "--gain-control: Adjust the LNA (HackRF) or TUNER (RTL-SDR) gain between bursts, lowering it on clipping or a high noise floor and raising it when the noise floor nears quantization." << endl;
+	cerr << "--latency: Measure latency from sample acquisition to tracker update, written to stderr on SIGUSR1 and at exit." << endl;
 }
 
 
@@ -62,33 +95,147 @@ void signalHandler(int signum) {
 }
 
 
-void processSample(const complex<float>& sample, Filter<complex<float>>& IFfilter, Filter<float>& BB_DC_remove, Filter<float>& BB_LP_filter, SensorMessageReceiver& message_receiver, SensorTracker& sensor_tracker) {
-	// Apply frequency translation and lowpass filter to IF
-	auto filt_samp = IFfilter.compute(sample);
-	if (!filt_samp) {	// If this sample is decimated
-		return;
+void latencySignalHandler(int signum) {
+	dump_latency = true;
+}
+
+
+/*
+ * Receives and decodes the samples of one radio until terminated, runs on a thread per radio.
+ * Decoded frames are handed to the tracker thread over the frame bus, see FramePolicy for when it falls behind.
+ */
+void receiveSamples(SoapySDR::Device* sdr, SoapySDR::Stream* rx_stream, DecodePipeline& pipeline, RadioStats& radio_stats, FrameBus& frames) {
+	// Create a re-usable buffer for rx samples
+	complex<float> buff[RX_BUF_SIZE];
+
+	// Messages are timestamped by the sample clock. Hardware timestamps are aligned to the wall clock once,
+	// by the first block that has one, until then the pipeline counts samples from its creation time.
+	bool clock_aligned = false;
+	long long int hardware_clock_offset = 0;	// Wall-clock time minus hardware time, ns
+
+	// Loop through sample buffers until sample stream is terminated
+	while (not_terminated.load()) {
+		void *buffs[] = {buff};
+		int flags = 0;
+		long long time_ns = 0;
+
+		// Read samples into buffer
+		int ret = sdr->readStream(rx_stream, buffs, RX_BUF_SIZE, flags, time_ns, 1e5);
+
+		if (ret < 0) {	// Report stream errors
+			if (ret == SOAPY_SDR_TIMEOUT) {
+				radio_stats.timeouts.add();
+			} else if (ret == SOAPY_SDR_OVERFLOW) {
+				radio_stats.overflows.add();
+			} else {
+				radio_stats.errors.add();
+				cerr << "Unknown readStream return code " << ret << endl;
+			}
+		} else {	// If sample stream is intact, process samples in buffer
+			radio_stats.blocks.add();
+			if (flags & SOAPY_SDR_HAS_TIME) {	// Follow the hardware clock, which also accounts for dropped samples
+				if (!clock_aligned) {
+					auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+					hardware_clock_offset = now - time_ns;
+					clock_aligned = true;
+				}
+				pipeline.setTime(time_ns + hardware_clock_offset);
+			}
+
+			pipeline.push(buff, ret, [&](std::shared_ptr<SensorMessage> sensor_message) {frames.push(std::move(sensor_message));});
+		}
+	}
+}
+
+
+/*
+ * Feeds file samples to a pipeline at speed times the sample rate, in place of a radio's receive thread.
+ * When processing falls further behind than a radio could buffer, the blocks the radio would have dropped
+ * are skipped and counted as an overflow. The end of the file terminates processing.
+ */
+void replaySamples(ifstream& input_file, const bool& cs8, const double& speed, DecodePipeline& pipeline, RadioStats& radio_stats, FrameBus& frames, ReplayStats& replay_stats) {
+	complex<float> buff[RX_BUF_SIZE];
+	const std::chrono::nanoseconds block_period((long long int)(RX_BUF_SIZE/SAMP_RATE/speed*NS_PER_SEC));
+	const auto start = std::chrono::steady_clock::now();
+	const long long int start_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	unsigned long long int block = 0;	// Blocks of the file so far, processed or dropped
+	while (not_terminated.load()) {
+		auto due = start + block*block_period;	// When a radio would deliver this block
+		auto now = std::chrono::steady_clock::now();
+		if (now < due) {
+			std::this_thread::sleep_until(due);
+		} else if (now - due > REPLAY_BUFFER_BLOCKS*block_period) {	// Skip to the block a radio would deliver after overflowing
+			radio_stats.overflows.add();
+			unsigned long long int current = (now - start)/block_period;
+			while ((block < current) && readSamples(input_file, cs8, buff)) {
+				replay_stats.dropped_blocks++;
+				block++;
+			}
+			if (block < current) {	// End of the file
+				break;
+			}
+			continue;
+		}
+
+		size_t num_samples = readSamples(input_file, cs8, buff);
+		if (!num_samples) {
+			break;
+		}
+		pipeline.setTime(start_time + block*RX_BUF_SIZE*NS_PER_SEC/(long long int)SAMP_RATE);	// As a radio's hardware timestamps would
+		radio_stats.blocks.add();
+
+		auto block_start = std::chrono::steady_clock::now();
+		pipeline.push(buff, num_samples, [&](std::shared_ptr<SensorMessage> sensor_message) {frames.push(std::move(sensor_message));});
+		long long int block_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - block_start).count();
+
+		replay_stats.samples += num_samples;
+		replay_stats.busy_ns += block_ns;
+		replay_stats.peak_block_ns = std::max(replay_stats.peak_block_ns, block_ns);
+		block++;
 	}
 
-	// Compute magnitude (BB) and apply highpass filter to center signal at zero.
-	// This allows BB pulse widths to be determined by tracking zero-crossings.
-	auto BB_DC_remove_samp = BB_DC_remove.compute(
-			filt_samp->real()*filt_samp->real() +	// Real^2
-			filt_samp->imag()*filt_samp->imag());	// Imag^2
-	if (!BB_DC_remove_samp) {	// If this sample is decimated
-		return;
+	not_terminated = false;	// Replay ends with the file
+}
+
+
+/*
+ * Parses a comma separated list of capture triggers, returns false if it is invalid
+ */
+bool parseTriggerList(const char* list, unsigned int& triggers) {
+	std::istringstream list_stream(list);
+	std::string trigger;
+	triggers = 0;
+	while (std::getline(list_stream, trigger, ',')) {
+		if (trigger == "sync") {
+			triggers |= CAPTURE_SYNC;
+		} else if (trigger == "pass") {
+			triggers |= CAPTURE_PASS;
+		} else if (trigger == "fail") {
+			triggers |= CAPTURE_FAIL;
+		} else {
+			return false;
+		}
 	}
 
-	// Use a lowpass filter to clean up signal and reduce undesireable zero crossings
-	auto BB_LP_filt_samp = BB_LP_filter.compute(*BB_DC_remove_samp);
-	if (!BB_LP_filt_samp) {	// If this sample is decimated
-		return;
+	return triggers;
+}
+
+
+/*
+ * Parses a comma separated list of device indices, returns false if it is invalid
+ */
+bool parseDeviceList(const char* list, std::vector<size_t>& device_indices) {
+	std::istringstream list_stream(list);
+	std::string index;
+	while (std::getline(list_stream, index, ',')) {
+		if (index.empty() || (index.find_first_not_of("0123456789") != std::string::npos)) {
+			return false;
+		}
+		device_indices.push_back(std::stoul(index));
 	}
 
-	// Process sensor messages if they exist
-	sensor_tracker.push(	// SensorTracker gets messages from SensorMessageReceiver
-			message_receiver.push(	// Extract messages from square wave signal
-					!signbit(*BB_LP_filt_samp)));	// Float to square wave conversion
-													// 0 when <0, 1 when >=0
+	return !device_indices.empty();
 }
 
 
@@ -98,34 +245,219 @@ int main(int argc, char* argv[]) {
 	 * -----------IDENTIFY SAMPLE SOURCE-----------
 	   --------------------------------------------*/
 
-	ifstream inputFile;
-	SoapySDR::KwargsList devices;
-	if (argc > 1) {	// If one or more parameters were passed in
-		// Check for help request
-		for (signed int i = 1; i<argc; i++) {
-			if (!strcmp(argv[i], "-h") | !strcmp(argv[i], "--help")) {
+	char* input_path = nullptr;
+	char* state_dir = nullptr;
+	char* query_socket = nullptr;
+	bool cs8_input = false;
+	double replay_speed = 0;	// File input is processed as fast as possible when 0
+	char* batch_input = nullptr;
+	char* capture_dir = nullptr;
+	char* tap_path = nullptr;
+	TapStage tap_stage = TAP_IF;
+	unsigned int capture_triggers = CAPTURE_FAIL;
+	unsigned int batch_threads = std::thread::hardware_concurrency();
+	unsigned int if_bandwidth = SENSOR_BW;
+	bool afc = false;
+	bool fixed_rate = false;
+	bool measure_latency = false;
+	bool report_stats = false;
+	bool monitor_spectrum = false;
+	bool gain_control = false;
+	FramePolicy frame_policy = FRAME_DROP_OLDEST;
+	std::vector<size_t> device_indices;	// Empty selects all devices
+	OutputFormat output_format = TEXT;
+	for (signed int i = 1; i<argc; i++) {
+		if (!strcmp(argv[i], "-h") | !strcmp(argv[i], "--help")) {	// Check for help request
+			printHelp(argv[0]);
+
+			return EXIT_SUCCESS;
+		} else if (!strcmp(argv[i], "--format") & (i+1 < argc)) {
+			i++;
+			if (!strcmp(argv[i], "text")) {
+				output_format = TEXT;
+			} else if (!strcmp(argv[i], "json")) {
+				output_format = JSON;
+			} else if (!strcmp(argv[i], "binary")) {
+				output_format = BINARY;
+			} else {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid output format." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[i], "--input-format") & (i+1 < argc)) {
+			i++;
+			if (strcmp(argv[i], "cf32") && strcmp(argv[i], "cs8")) {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid input format." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+			cs8_input = !strcmp(argv[i], "cs8");
+		} else if (!strcmp(argv[i], "--replay") & (i+1 < argc)) {
+			i++;
+			char* end;
+			replay_speed = strtod(argv[i], &end);
+			if (*end || !(replay_speed > 0)) {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid replay speed." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[i], "--batch") & (i+1 < argc)) {
+			batch_input = argv[++i];
+		} else if (!strcmp(argv[i], "--threads") & (i+1 < argc)) {
+			i++;
+			char* end;
+			batch_threads = strtoul(argv[i], &end, 10);
+			if (*end || !batch_threads) {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid number of threads." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[i], "--capture-dir") & (i+1 < argc)) {
+			capture_dir = argv[++i];
+		} else if (!strcmp(argv[i], "--capture-on") & (i+1 < argc)) {
+			i++;
+			if (!parseTriggerList(argv[i], capture_triggers)) {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid capture trigger list." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[i], "--tap") & (i+2 < argc)) {
+			i++;
+			if (strcmp(argv[i], "if") && strcmp(argv[i], "bb")) {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid tap stage." << endl << endl;
 				printHelp(argv[0]);
 
-				return EXIT_SUCCESS;
+				return EXIT_FAILURE;
 			}
+			tap_stage = strcmp(argv[i], "if") ? TAP_BB : TAP_IF;
+			tap_path = argv[++i];
+		} else if (!strcmp(argv[i], "--if-bw") & (i+1 < argc)) {
+			i++;
+			char* end;
+			if_bandwidth = strtoul(argv[i], &end, 10);
+			if (*end || (if_bandwidth < 2*IF_FILT_TRANSITION) || (if_bandwidth > SAMP_RATE/IF_FILT_DECIMATION)) {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid IF bandwidth, it must be from " << 2*IF_FILT_TRANSITION << " to " << SAMP_RATE/IF_FILT_DECIMATION << " Hz." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[i], "--afc")) {
+			afc = true;
+		} else if (!strcmp(argv[i], "--fixed-rate")) {
+			fixed_rate = true;
+		} else if (!strcmp(argv[i], "--state-dir") & (i+1 < argc)) {
+			state_dir = argv[++i];
+		} else if (!strcmp(argv[i], "--devices") & (i+1 < argc)) {
+			i++;
+			if (strcmp(argv[i], "all") && !parseDeviceList(argv[i], device_indices)) {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid device list." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[i], "--stats")) {
+			report_stats = true;
+		} else if (!strcmp(argv[i], "--spectrum")) {
+			monitor_spectrum = true;
+			report_stats = true;	// The spectrum is reported with the stats
+		} else if (!strcmp(argv[i], "--gain-control")) {
+			gain_control = true;
+		} else if (!strcmp(argv[i], "--frame-policy") & (i+1 < argc)) {
+			i++;
+			if (!strcmp(argv[i], "drop-oldest")) {
+				frame_policy = FRAME_DROP_OLDEST;
+			} else if (!strcmp(argv[i], "block")) {
+				frame_policy = FRAME_BLOCK;
+			} else {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid frame policy." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[i], "--latency")) {
+			measure_latency = true;
+		} else if (!strcmp(argv[i], "--query-socket") & (i+1 < argc)) {
+			query_socket = argv[++i];
+		} else if ((argv[i][0] != '-') & !input_path) {
+			input_path = argv[i];
+		} else {
+			cerr << "\"" << argv[i] << "\"" << " is not a valid option." << endl << endl;
+			printHelp(argv[0]);
+
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (batch_input) {	// Archived captures are decoded on their own, without the SDR or live outputs
+		try {
+			BatchProcessor batch_processor(batch_input, cs8_input, cout, batch_threads);
+			batch_processor.run();
+		} catch (BatchError& e) {
+			cerr << "No input files found at \"" << batch_input << "\"." << endl;
+			return EXIT_FAILURE;
 		}
 
-		// If no help request received, try to open a user-selected input file
-		inputFile.open(argv[1], std::ios::in | std::ios::binary);
+		return EXIT_SUCCESS;
+	}
+
+	// Hardware information goes to stderr when stdout carries machine-readable reports
+	std::ostream& info = (output_format == TEXT) ? cout : cerr;
+
+	ifstream inputFile;
+	std::optional<TapHeader> tap_input;	// Set when the input file is a tap file
+	SoapySDR::KwargsList devices;
+	if (replay_speed && !input_path) {
+		cerr << "--replay requires an input file." << endl << endl;
+		printHelp(argv[0]);
+
+		return EXIT_FAILURE;
+	}
+	if (input_path) {	// Try to open a user-selected input file
+		inputFile.open(input_path, std::ios::in | std::ios::binary);
 		if (!inputFile) {
-			cerr << "\"" << argv[1] << "\"" << " is not a valid input file." << endl << endl;
+			cerr << "\"" << input_path << "\"" << " is not a valid input file." << endl << endl;
 			printHelp(argv[0]);
 
 			return EXIT_FAILURE;
 		}
+
+		try {	// Tap files resume decoding after the IF filter
+			if (isTapFile(inputFile)) {
+				tap_input = readTapHeader(inputFile);
+			}
+		} catch (TapError& e) {
+			cerr << "\"" << input_path << "\"" << ((e == TAP_RATE_MISMATCH) ? " was tapped at a different sample rate or IF decimation." : " has an invalid tap header.") << endl;
+			return EXIT_FAILURE;
+		}
+		if (tap_input && replay_speed) {
+			cerr << "--replay needs raw samples, \"" << input_path << "\"" << " is a tap file." << endl;
+			return EXIT_FAILURE;
+		}
 	} else {	// Default to SDR hardware sample source and verify that one is available
 		// Get list of connected devices
 		devices = SoapySDR::Device::enumerate();
 
 		if (devices.empty()) {
-			cout << "No devices found, please connect a device and try again." << endl;
+			info << "No devices found, please connect a device and try again." << endl;
 			return EXIT_FAILURE;
 		}
+
+		if (device_indices.empty()) {
+			for (size_t i = 0; i < devices.size(); i++) {
+				device_indices.push_back(i);
+			}
+		}
+		for (const auto& index : device_indices) {
+			if (index >= devices.size()) {
+				cerr << "Device " << index << " was not found, " << devices.size() << " devices are connected." << endl;
+				return EXIT_FAILURE;
+			}
+		}
 	}
 
 
@@ -135,21 +467,156 @@ int main(int argc, char* argv[]) {
 	 * ------CREATE SIGNAL PROCESSING OBJECTS------
 	   --------------------------------------------*/
 
-	// Configure IF (complex LPF with frequency Xlation) and BB (HPF) filters
-	Filter<complex<float>> IFfilter(LPF, SAMP_RATE, IF_FILT_DECIMATION, SENSOR_BW/2, IF_FILT_TRANSITION, FILT_ATTENUATION,
-			TUNE_FREQ_OFFSET);	// Includes frequency translation.
-															// The HackRF One samples have significant DC noise, so
-															// tuning the hardware to some offset frequency and translating
-															// the signal back to FFT center in the digital domain greatly
-															// improves SNR.
-	Filter<float> BB_DC_remove(HPF, SAMP_RATE/IF_FILT_DECIMATION, BB_DC_FILT_DECIMATION, BB_DC_FILT_CUTOFF, BB_DC_FILT_TRANSITION, FILT_ATTENUATION);
-	Filter<float> BB_LP_filter(LPF, SAMP_RATE/(IF_FILT_DECIMATION*BB_DC_FILT_DECIMATION), BB_LP_FILT_DECIMATION, BB_LP_FILT_CUTOFF, BB_LP_FILT_TRANSITION, FILT_ATTENUATION);
+	// Reports are formatted and written on a separate thread, created first so it outlives the tracker summary
+	EventWriter event_writer(output_format);
+	FrameDeduplicator frame_dedup(&event_writer);	// Shared by all radios, so copies of a frame heard by several radios are collapsed
+
+	// Restore sensor state persisted by a previous run
+	SnapshotPublisher<TrackerSnapshot> snapshot_publisher;	// Outlives the tracker, which publishes to it until destroyed
+	std::unique_ptr<StateStore> state_store;
+	std::unique_ptr<SensorTracker> sensor_tracker_ptr;
+	try {
+		auto restore_start = std::chrono::steady_clock::now();
+		if (state_dir) {
+			state_store = std::make_unique<StateStore>(state_dir);
+		}
+		sensor_tracker_ptr = std::make_unique<SensorTracker>(&event_writer, state_store.get());
+
+		if (state_store) {
+			std::chrono::duration<double, std::milli> restore_time = std::chrono::steady_clock::now() - restore_start;
+			info << "Restored " << sensor_tracker_ptr->size() << " sensors from \"" << state_dir << "\" in " << restore_time.count() << " ms" << endl;
+		}
+	} catch (StoreError& e) {
+		cerr << "Sensor state in \"" << state_dir << "\" could not be " << ((e == STORE_CORRUPT) ? "read, it is corrupt." : "opened.") << endl;
+		return EXIT_FAILURE;
+	}
+	SensorTracker& sensor_tracker = *sensor_tracker_ptr;
+
+	// Answer live state queries from snapshots published by the tracker
+	std::unique_ptr<QueryServer> query_server;
+	if (query_socket) {
+		try {
+			sensor_tracker.publishSnapshots(&snapshot_publisher);
+			query_server = std::make_unique<QueryServer>(query_socket, snapshot_publisher);
+		} catch (QueryError& e) {
+			cerr << "Query socket \"" << query_socket << "\" could not be " << ((e == SOCKET_CREATE_FAILED) ? "created." : "bound.") << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Raw IQ around triggering frames, recorded by each pipeline and written on a separate thread
+	std::unique_ptr<CaptureWriter> capture_writer;
+	std::vector<std::unique_ptr<IQRecorder>> recorders;
+	if (capture_dir) {
+		try {
+			capture_writer = std::make_unique<CaptureWriter>(capture_dir);
+		} catch (CaptureError& e) {
+			cerr << "Capture directory \"" << capture_dir << "\" could not be created." << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	auto recordPipeline = [&](DecodePipeline& pipeline, const unsigned char& receiver) {
+		if (capture_writer && !tap_input) {	// Tap files hold no raw samples to capture
+			recorders.push_back(std::make_unique<IQRecorder>(*capture_writer, receiver, capture_triggers));
+			pipeline.recordTo(recorders.back().get());
+		}
+	};
+
+	// IF spectrum of each pipeline, analysed on separate idle-priority threads
+	std::vector<std::unique_ptr<SpectrumMonitor>> monitors;
+	auto monitorPipeline = [&](DecodePipeline& pipeline) {
+		if (monitor_spectrum | gain_control) {	// Gain control is driven by the spectrum statistics
+			monitors.push_back(std::make_unique<SpectrumMonitor>(pipeline.getPlan().ifRate()));
+			pipeline.monitorTo(monitors.back().get());
+		}
+	};
+
+	// Samples leaving one stage of the (single) pipeline, saved to be decoded again from that stage
+	std::unique_ptr<StageTap> stage_tap;
+	if (tap_path) {
+		if (!inputFile.is_open() && (device_indices.size() > 1)) {
+			cerr << "--tap saves the samples of one device, select one with --devices." << endl;
+			return EXIT_FAILURE;
+		}
+		try {
+			stage_tap = std::make_unique<StageTap>(tap_path, tap_stage);
+		} catch (TapError& e) {
+			cerr << "Tap file \"" << tap_path << "\" could not be created." << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Histograms of the latency of each decoded event, from sample acquisition to tracker update
+	std::unique_ptr<PipelineLatency> latency;
+	if (measure_latency) {
+		latency = std::make_unique<PipelineLatency>();
+		sensor_tracker.measureLatency(latency.get());
+		signal(SIGUSR1, latencySignalHandler);
+	}
+	auto printLatency = [&](const bool& requested) {	// Requested by SIGUSR1, or unconditionally at exit
+		if (latency && (dump_latency.exchange(false) | !requested)) {
+			latency->print(cerr);
+		}
+	};
+
+	// Per-stage counters, reported periodically
+	TrackerStats tracker_stats;
+	std::unique_ptr<StatsReporter> stats_reporter;
+	if (report_stats) {
+		stats_reporter = std::make_unique<StatsReporter>(tracker_stats);
+	}
+
+	auto trackFrame = [&](std::shared_ptr<SensorMessage> sensor_message) {
+		long long int start = stats_reporter ? latencyClock() : 0;
+		auto event_message = frame_dedup.push(sensor_message);	// Collapse repeated frames, including copies from other devices
+		if (event_message) {	// SensorTracker gets one message per event from FrameDeduplicator
+			sensor_tracker.push(std::move(event_message));
+		} else if (sensor_message) {	// and each repeat confirms the sensor
+			sensor_tracker.confirm(sensor_message->getTXID());
+		}
+		if (stats_reporter) {
+			tracker_stats.ns.add(latencyClock() - start);
+			tracker_stats.messages.add();
+		}
+	};
+
+	// Frames decoded by radio threads (or a paced replay) are tracked on this thread
+	FrameBus frames(frame_policy);
+	if (stats_reporter) {
+		stats_reporter->addFrameBus(frames);
+	}
+	auto trackFrames = [&](std::vector<std::thread>& receiver_threads, const bool& wall_clock) {	// Until all radios are terminated
+		while (not_terminated.load()) {
+			while (frames.drain(trackFrame));
 
-	// Create decoder for 345 data with estimated sample per symbol value for finding sync bits.
-	// The decoder computes more accurate SPS estimations per-message using sync bits
-	// for overall SPS accuracy throughout the message.
-	SensorMessageReceiver message_receiver(PULSE_WIDTH*(SAMP_RATE/(IF_FILT_DECIMATION*BB_DC_FILT_DECIMATION*BB_LP_FILT_DECIMATION)));
-	SensorTracker sensor_tracker;
+			if (wall_clock) {	// Radio messages are timed by the wall clock, so events can be closed while no frames arrive
+				frame_dedup.expire(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+			}
+			sensor_tracker.tick(time(NULL));	// Keep published snapshots current while no frames arrive
+			printLatency(true);
+			if (stats_reporter) {
+				stats_reporter->tick();
+			}
+			frames.wait(std::chrono::milliseconds(TRACKER_IDLE_WAIT));
+		}
+
+		for (auto& receiver_thread : receiver_threads) {
+			receiver_thread.join();
+		}
+		while (frames.drain(trackFrame));	// Track frames decoded before shutdown
+		frame_dedup.flush();
+
+		printLatency(false);
+		if (stats_reporter) {
+			stats_reporter->report();
+		}
+		if (frames.getDropped()) {
+			cerr << frames.getDropped() << " DECODED FRAMES DROPPED" << endl;
+		}
+		if (frames.getBlocked()) {
+			cerr << "DECODERS WAITED ON THE TRACKER " << frames.getBlocked() << " TIMES" << endl;
+		}
+	};
 
 
 
@@ -158,115 +625,246 @@ int main(int argc, char* argv[]) {
 	 * ----INITIATE THE SELECTED SAMPLE SOURCE----
 	   -------------------------------------------*/
 
-	if (inputFile.is_open()) {	// If file source was selected, fully process the file
-		complex<float> sample;
-		while (inputFile.read((char *)&sample, sizeof(complex<float>))) {
-			processSample(sample, IFfilter, BB_DC_remove, BB_LP_filter, message_receiver, sensor_tracker);
+	if (inputFile.is_open() && replay_speed) {	// Replay the file at a radio's pace, on its own thread as a radio would be
+		signal(SIGINT, signalHandler);
+
+		DecodePipeline pipeline(0, &event_writer, if_bandwidth);
+		if (afc) {
+			pipeline.enableAFC();
+		}
+		recordPipeline(pipeline, 0);
+		monitorPipeline(pipeline);
+		pipeline.tapTo(stage_tap.get());
+		RadioStats radio_stats;
+		if (stats_reporter) {
+			pipeline.enableStats();
+			stats_reporter->addPipeline(0, pipeline, &radio_stats);
+		}
+
+		ReplayStats replay_stats;
+		std::vector<std::thread> receiver_threads;
+		receiver_threads.emplace_back(replaySamples, std::ref(inputFile), cs8_input, replay_speed, std::ref(pipeline), std::ref(radio_stats), std::ref(frames), std::ref(replay_stats));
+		trackFrames(receiver_threads, false);	// Replayed messages are timed at the replay speed
+
+		double replay_seconds = replay_stats.samples/SAMP_RATE;
+		cerr << "REPLAYED " << replay_seconds << " SECONDS AT " << replay_speed << "X" << endl;
+		cerr << "Real-time factor: " << (replay_stats.busy_ns ? replay_seconds*NS_PER_SEC/replay_stats.busy_ns : 0) << "x" << endl;
+		cerr << "Peak block processing: " << replay_stats.peak_block_ns/1e6 << " ms of " << RX_BUF_SIZE/SAMP_RATE/replay_speed*1e3 << " ms block duration" << endl;
+		cerr << "Would-be overflows: " << radio_stats.overflows.get() << ", " << replay_stats.dropped_blocks << " blocks dropped" << endl;
+
+		return EXIT_SUCCESS;
+	}
+
+	if (inputFile.is_open()) {	// If file source was selected, fully process the file on this thread
+		DecodePipeline pipeline(0, &event_writer, if_bandwidth);
+		if (afc) {
+			pipeline.enableAFC();
+		}
+		recordPipeline(pipeline, 0);
+		monitorPipeline(pipeline);
+		pipeline.tapTo(stage_tap.get());
+		if (stats_reporter) {
+			pipeline.enableStats();
+			stats_reporter->addPipeline(0, pipeline);
+		}
+		auto blockDone = [&]() {
+			printLatency(true);
+			if (stats_reporter) {
+				stats_reporter->tick();
+			}
+		};
+
+		complex<float> buff[RX_BUF_SIZE];
+		if (!tap_input) {
+			while (size_t num_samples = readSamples(inputFile, cs8_input, buff)) {
+				pipeline.push(buff, num_samples, trackFrame);
+				blockDone();
+			}
+		} else {
+			if (!tapFiltersMatch(*tap_input, pipeline.getIFCutoff(), pipeline.getIFTaps())) {
+				cerr << "\"" << input_path << "\"" << " was tapped with different IF filter parameters, results may differ from the raw samples." << endl;
+			}
+			pipeline.setTime(tap_input->start_time);
+
+			if (tap_input->stage == TAP_IF) {
+				while (size_t num_samples = readSamples(inputFile, false, buff)) {
+					pipeline.pushIF(buff, num_samples, trackFrame);
+					blockDone();
+				}
+			} else {
+				float bb_buff[RX_BUF_SIZE];
+				while (inputFile.read((char *)bb_buff, sizeof(bb_buff)) || inputFile.gcount()) {
+					pipeline.pushBB(bb_buff, inputFile.gcount()/sizeof(float), trackFrame);
+					blockDone();
+				}
+			}
 		}
 
+		frame_dedup.flush();
+
+		printLatency(false);
+		if (stats_reporter) {
+			stats_reporter->report();
+		}
 		return EXIT_SUCCESS;
 	}	// Else default to SDR source
 
 	// Output list of connected devices and their properties
 	for (const auto& device : devices) {
-		cout << "Found ";
+		info << "Found ";
 		for (const auto& prop : device) {
-			cout << prop.first << " = " << prop.second << endl;
+			info << prop.first << " = " << prop.second << endl;
 		}
-		cout << endl;
+		info << endl;
 	}
 
-	// Make device zero
-	SoapySDR::Device *sdr = SoapySDR::Device::make(devices[0]);
-	if (sdr == nullptr) {
-		cerr << "SoapySDR::Device::make failed" << endl;
-		return EXIT_FAILURE;
-	}
+	// Make, configure, and start streaming from each selected device
+	std::vector<SoapySDR::Device*> sdrs;
+	std::vector<SoapySDR::Stream*> rx_streams;
+	std::vector<RatePlan> plans;	// Of each device
+	std::vector<std::string> gain_elements;	// Of each device, adjusted by gain control, empty if none
+	auto closeDevices = [&]() {
+		for (size_t i = 0; i < sdrs.size(); i++) {
+			if (rx_streams[i]) {
+				sdrs[i]->deactivateStream(rx_streams[i], 0, 0);	//stop streaming
+				sdrs[i]->closeStream(rx_streams[i]);
+			}
 
+			// Cleanup device handle
+			SoapySDR::Device::unmake(sdrs[i]);
+		}
+	};
 
+	for (const auto& index : device_indices) {
+		SoapySDR::Device *sdr = SoapySDR::Device::make(devices[index]);
+		if (sdr == nullptr) {
+			cerr << "SoapySDR::Device::make failed for device " << index << endl;
+			closeDevices();
+			return EXIT_FAILURE;
+		}
+		sdrs.push_back(sdr);
+		rx_streams.push_back(nullptr);
 
 
-	/* -------------------------------------------
-	 * -----------QUERY SELECTED DEVICE-----------
-	   -------------------------------------------*/
 
-	cout << endl << "HARDWARE OPTIONS" << endl;
 
-	//	List available antenna ports on device
-	cout << "Rx antennas: ";
-	for (const auto& antenna : sdr->listAntennas(SOAPY_SDR_RX, 0)) {
-		cout << antenna << ", ";
-	}
-	cout << endl;
+		/* -------------------------------------------
+		 * -----------QUERY SELECTED DEVICE-----------
+		   -------------------------------------------*/
 
-	//	List available gains on device
-	cout << "Rx gains: ";
-	for (const auto& gain : sdr->listGains(SOAPY_SDR_RX, 0)) {
-		cout << gain << ", ";
-	}
-	cout << endl;
+		info << endl << "DEVICE " << index << " HARDWARE OPTIONS" << endl;
 
-	//	List frequency ranges of device
-	cout << "Rx freq ranges: ";
-	for (const auto& freq_range : sdr->getFrequencyRange(SOAPY_SDR_RX, 0)) {
-		cout << "[" << freq_range.minimum() << " Hz -> " << freq_range.maximum() << " Hz], ";
-	}
-	cout << endl;
+		//	List available antenna ports on device
+		info << "Rx antennas: ";
+		for (const auto& antenna : sdr->listAntennas(SOAPY_SDR_RX, 0)) {
+			info << antenna << ", ";
+		}
+		info << endl;
 
+		//	List available gains on device
+		info << "Rx gains: ";
+		for (const auto& gain : sdr->listGains(SOAPY_SDR_RX, 0)) {
+			info << gain << ", ";
+		}
+		info << endl;
 
+		//	List frequency ranges of device
+		info << "Rx freq ranges: ";
+		for (const auto& freq_range : sdr->getFrequencyRange(SOAPY_SDR_RX, 0)) {
+			info << "[" << freq_range.minimum() << " Hz -> " << freq_range.maximum() << " Hz], ";
+		}
+		info << endl;
 
 
-	/* -----------------------------------------
-	 * --------CONFIGURE SELECTED DEVICE--------
-	   -----------------------------------------*/
 
-	cout << endl << "HARDWARE CONFIGURATION" << endl;
 
-	// Disable automatic gain control
-	sdr->setGainMode(SOAPY_SDR_RX, 0, false);
+		/* -----------------------------------------
+		 * --------CONFIGURE SELECTED DEVICE--------
+		   -----------------------------------------*/
+
+		info << endl << "DEVICE " << index << " HARDWARE CONFIGURATION" << endl;
+
+		// Disable automatic gain control
+		sdr->setGainMode(SOAPY_SDR_RX, 0, false);
 
-	// Configure manual gain stages
-	for (const auto& gain : sdr->listGains(SOAPY_SDR_RX, 0)) {
-		std::cout << gain;
+		// Configure manual gain stages
+		for (const auto& gain : sdr->listGains(SOAPY_SDR_RX, 0)) {
+			info << gain;
 
-		if (gain == "LNA") {
-			sdr->setGain(SOAPY_SDR_RX, 0, gain, 20);
-		} else if (gain == "VGA") {
-			sdr->setGain(SOAPY_SDR_RX, 0, gain, 20);
-		} else if (gain == "AMP") {
-			sdr->setGain(SOAPY_SDR_RX, 0, gain, 0);
-		} else if (gain == "TUNER") {	// RTL-SDR
-			sdr->setGain(SOAPY_SDR_RX, 0, gain, 40);
+			if (gain == "LNA") {
+				sdr->setGain(SOAPY_SDR_RX, 0, gain, 20);
+			} else if (gain == "VGA") {
+				sdr->setGain(SOAPY_SDR_RX, 0, gain, 20);
+			} else if (gain == "AMP") {
+				sdr->setGain(SOAPY_SDR_RX, 0, gain, 0);
+			} else if (gain == "TUNER") {	// RTL-SDR
+				sdr->setGain(SOAPY_SDR_RX, 0, gain, 40);
+			}
+			info << " gain: " << std::setfill('0') << std::setw(2) << sdr->getGain(SOAPY_SDR_RX, 0, gain) << " dB" << endl;
 		}
-		std::cout << " gain: " << std::setfill('0') << std::setw(2) << sdr->getGain(SOAPY_SDR_RX, 0, gain) << " dB" << std::endl;
-	}
-	
-	// Configure sample rate
-	sdr->setSampleRate(SOAPY_SDR_RX, 0, SAMP_RATE);
-	cout << "Sample rate: " << sdr->getSampleRate(SOAPY_SDR_RX, 0) << " samples/second" << endl;
 
-	// Configure frequency
-	sdr->setFrequency(SOAPY_SDR_RX, 0, SIG_FREQ+TUNE_FREQ_OFFSET);
-	cout << "Freqency: " << sdr->getFrequency(SOAPY_SDR_RX, 0) << " Hz" << endl;
+		// Gain element adjusted by gain control, the first stage where there is a choice
+		gain_elements.emplace_back();
+		if (gain_control) {
+			for (const auto& gain : sdr->listGains(SOAPY_SDR_RX, 0)) {
+				if ((gain == "LNA") | (gain == "TUNER")) {
+					gain_elements.back() = gain;
+				}
+			}
+			info << "Gain control: " << (gain_elements.back().empty() ? "no LNA or TUNER gain, disabled" : gain_elements.back()) << endl;
+		}
+
+		// Configure sample rate, the cheapest one the device supports unless samples are saved, which must be at the nominal rate
+		RatePlan plan = nominalPlan();
+		if (!fixed_rate && !capture_dir && !tap_path) {
+			std::vector<RateRange> ranges;
+			for (const auto& range : sdr->getSampleRateRange(SOAPY_SDR_RX, 0)) {
+				ranges.push_back({range.minimum(), range.maximum()});
+			}
+			if (ranges.empty()) {
+				for (const auto& rate : sdr->listSampleRates(SOAPY_SDR_RX, 0)) {
+					ranges.push_back({rate, rate});
+				}
+			}
+
+			try {
+				if (!ranges.empty()) {
+					plan = planRates(ranges, std::max<unsigned int>(if_bandwidth, SENSOR_BW));
+				}
+			} catch (RatePlanError& e) {
+				cerr << "No sample rate of device " << index << " suits the filter chain, trying " << SAMP_RATE << " samples/second." << endl;
+			}
+		}
+		plans.push_back(plan);
+
+		sdr->setSampleRate(SOAPY_SDR_RX, 0, plan.samp_rate);
+		info << "Sample rate: " << sdr->getSampleRate(SOAPY_SDR_RX, 0) << " samples/second" << endl;
+		info << "Decimation: IF " << plan.if_decimation << ", BB " << plan.bb_lp_decimation << " (" << plan.bbRate() << " samples/second at the receiver)" << endl;
+		info << "Filter cost: " << plan.cost/1e6 << " M multiplies/second, " << std::lround(100*plan.cost/nominalPlan().cost) << "% of the nominal plan" << endl;
+		if (sdr->getSampleRate(SOAPY_SDR_RX, 0) != plan.samp_rate) {
+			cerr << "Device " << index << " did not accept the planned sample rate, messages will not be decoded correctly." << endl;
+		}
 
+		// Configure frequency
+		sdr->setFrequency(SOAPY_SDR_RX, 0, SIG_FREQ+plan.tune_offset);
+		info << "Freqency: " << sdr->getFrequency(SOAPY_SDR_RX, 0) << " Hz" << endl;
 
 
 
-	/* -----------------------------------------
-	 * ---------CONFIGURE SAMPLE STREAM---------
-	   -----------------------------------------*/
 
-	// Setup a stream (complex floats)
-	SoapySDR::Stream *rx_stream = sdr->setupStream(SOAPY_SDR_RX, SOAPY_SDR_CF32);
-	if(rx_stream == nullptr) {
-		cerr << "Sample stream creation failed" << endl;
-		SoapySDR::Device::unmake(sdr);
-		return EXIT_FAILURE;
-	}
-	sdr->activateStream(rx_stream, 0, 0, 0);
+		/* -----------------------------------------
+		 * ---------CONFIGURE SAMPLE STREAM---------
+		   -----------------------------------------*/
 
-	// Create a re-usable buffer for rx samples
-	complex<float> buff[RX_BUF_SIZE];
+		// Setup a stream (complex floats)
+		rx_streams.back() = sdr->setupStream(SOAPY_SDR_RX, SOAPY_SDR_CF32);
+		if (rx_streams.back() == nullptr) {
+			cerr << "Sample stream creation failed for device " << index << endl;
+			closeDevices();
+			return EXIT_FAILURE;
+		}
+		sdr->activateStream(rx_streams.back(), 0, 0, 0);
+	}
 
 
 
@@ -278,32 +876,45 @@ int main(int argc, char* argv[]) {
 	// Register signal SIGINT and signal handler to cleanly exit processing loop
 	signal(SIGINT, signalHandler);
 
-	// Loop through sample buffers until sample stream is terminated
-	while (not_terminated) {
-		void *buffs[] = {buff};
-		int flags;
-		long long time_ns;
-
-		// Read samples into buffer
-		int ret = sdr->readStream(rx_stream, buffs, RX_BUF_SIZE, flags, time_ns, 1e5);
-		
-		if (ret < 0) {	// Report stream errors
-			if ((ret != SOAPY_SDR_TIMEOUT) & (ret != SOAPY_SDR_OVERFLOW)) {
-				cout << "Unknown readStream return code " << ret << endl;
-			}
-		} else {	// If sample stream is intact, process samples in buffer
-			for (auto const& sample : buff) {
-				processSample(sample, IFfilter, BB_DC_remove, BB_LP_filter, message_receiver, sensor_tracker);
-			}
+	// Decode each device on its own thread, all feeding decoded frames to the tracker on this thread
+	std::vector<std::unique_ptr<DecodePipeline>> pipelines;
+	std::vector<std::unique_ptr<GainController>> gain_controllers;	// Stopped before the devices are closed
+	auto radio_stats = std::make_unique<RadioStats[]>(sdrs.size());
+	std::vector<std::thread> receiver_threads;
+	for (size_t i = 0; i < sdrs.size(); i++) {
+		pipelines.push_back(std::make_unique<DecodePipeline>(device_indices[i], &event_writer, if_bandwidth, plans[i]));
+		if (afc) {
+			pipelines.back()->enableAFC();
 		}
+		recordPipeline(*pipelines.back(), device_indices[i]);
+		monitorPipeline(*pipelines.back());
+		pipelines.back()->tapTo(stage_tap.get());	// Only one device when tapping
+		GainController* gain_controller = nullptr;
+		if (!gain_elements[i].empty()) {
+			auto sdr = sdrs[i];
+			auto element = gain_elements[i];
+			auto range = sdr->getGainRange(SOAPY_SDR_RX, 0, element);
+			gain_controllers.push_back(std::make_unique<GainController>(*pipelines.back(), *pipelines.back()->getMonitor(),
+					sdr->getGain(SOAPY_SDR_RX, 0, element), range.minimum(), range.maximum(),
+					[sdr, element](const double& gain) {
+						sdr->setGain(SOAPY_SDR_RX, 0, element, gain);
+						return sdr->getGain(SOAPY_SDR_RX, 0, element);
+					}));
+			gain_controller = gain_controllers.back().get();
+		}
+		if (stats_reporter) {
+			pipelines.back()->enableStats();
+			stats_reporter->addPipeline(device_indices[i], *pipelines.back(), &radio_stats[i], gain_controller);
+		}
+		receiver_threads.emplace_back(receiveSamples, sdrs[i], rx_streams[i], std::ref(*pipelines.back()), std::ref(radio_stats[i]), std::ref(frames));
 	}
-	
-	// Shutdown the stream
-	sdr->deactivateStream(rx_stream, 0, 0);	//stop streaming
-	sdr->closeStream(rx_stream);
 
-	// Cleanup device handle
-	SoapySDR::Device::unmake(sdr);
+	// Track frames until all devices are terminated
+	trackFrames(receiver_threads, true);
+
+	// Shutdown the streams and cleanup device handles
+	gain_controllers.clear();
+	closeDevices();
 
 	return EXIT_SUCCESS;
 }
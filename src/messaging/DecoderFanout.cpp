@@ -0,0 +1,128 @@
+#include "DecoderFanout.h"
+
+#include <algorithm>
+
+
+void DecoderFanout::add(ProtocolDecoder* decoder) {
+	slots.push_back({decoder, decoder->getPrematch(), 0, 0, false, 0});
+}
+
+
+std::shared_ptr<SensorMessage> DecoderFanout::push(const bool& sample, std::shared_ptr<SensorMessage> sensor_message) {
+	bool edge = (sample != level);
+	if (edge) {
+		endRun();
+		level = sample;
+		run_len = 0;
+	}
+	run_len++;
+
+	if (!held.empty()) {
+		pass(sensor_message, std::move(held.front()));
+		held.pop_front();
+	}
+	if (!awake_decoders) {	// Nothing but run lengths to track
+		return sensor_message;
+	}
+
+	for (auto& slot : slots) {
+		if (!slot.awake) {
+			continue;
+		}
+
+		auto decoded = slot.decoder->push(sample);
+		if (slot.decoder->receiving() && !receiving()) {	// Frame started
+			framing = slot.decoder;
+		}
+		pass(sensor_message, std::move(decoded));
+
+		// Only once the decoder has taken the run that ended, its sync sequence may end on that run
+		if (edge && !slot.decoder->receiving()) {
+			slot.awake = false;
+			slot.seen_runs = runs;
+			awake_decoders--;
+		}
+	}
+
+	return sensor_message;
+}
+
+
+/*
+ * Records the run that just ended, and wakes each decoder whose sync levels its symbols complete
+ */
+void DecoderFanout::endRun() {
+	history[history_front] = {level, run_len};
+	history_front = (history_front+1) % FANOUT_HISTORY_RUNS;
+	runs++;
+
+	for (auto& slot : slots) {
+		slot.pending_len += run_len;
+		if (slot.pending_len < slot.prematch.min_len) {	// Glitch
+			continue;
+		}
+
+		bool matched = false;	// The sync sequence may end on the first symbol of two
+		for (unsigned int i = (slot.pending_len > slot.prematch.max_len) ? 2 : 1; i>0; i--) {
+			slot.levels = (slot.levels<<1) | level;
+			matched |= !((slot.levels ^ slot.prematch.levels) & slot.prematch.mask);
+		}
+		slot.pending_len = 0;
+
+		if (!slot.awake && matched) {
+			wake(slot);
+		}
+	}
+}
+
+
+/*
+ * Replays the runs missed while asleep, oldest first, the sample that ended the last of them is pushed next as usual.
+ * Only the last replay_len samples are replayed, the oldest run is cut short to fit.
+ */
+void DecoderFanout::wake(Slot& slot) {
+	unsigned int missed = std::min<unsigned long long int>(runs - slot.seen_runs, FANOUT_HISTORY_RUNS);
+	unsigned int first = FANOUT_HISTORY_RUNS;	// Oldest run replayed
+	unsigned long int replay_len = 0;
+	while ((first > FANOUT_HISTORY_RUNS - missed) && (replay_len < slot.prematch.replay_len)) {
+		first--;
+		replay_len += history[(history_front+first) % FANOUT_HISTORY_RUNS].len;
+	}
+
+	for (unsigned int i = first; i < FANOUT_HISTORY_RUNS; i++) {
+		const auto& run = history[(history_front+i) % FANOUT_HISTORY_RUNS];
+		unsigned int len = run.len;
+		if (replay_len > slot.prematch.replay_len) {	// Oldest run
+			len -= replay_len - slot.prematch.replay_len;
+			replay_len = slot.prematch.replay_len;
+		}
+		for (unsigned int j = 0; j < len; j++) {
+			auto decoded = slot.decoder->push(run.level);
+			if (decoded) {	// A frame ending in the replay is handed on like frames ending on the same sample
+				held.push_back(std::move(decoded));
+			}
+		}
+	}
+	if (slot.decoder->receiving() && !receiving()) {
+		framing = slot.decoder;
+	}
+
+	slot.awake = true;
+	awake_decoders++;
+}
+
+
+/*
+ * Decoders lock onto different sync sequences, so frames rarely end on the same sample, later ones are held for the next samples
+ */
+void DecoderFanout::pass(std::shared_ptr<SensorMessage>& sensor_message, std::shared_ptr<SensorMessage> decoded) {
+	if (!decoded) {
+		return;
+	}
+
+	if (sensor_message) {
+		held.push_back(std::move(decoded));
+	} else {
+		sensor_message = std::move(decoded);
+	}
+}
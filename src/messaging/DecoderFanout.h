@@ -0,0 +1,56 @@
+#ifndef SRC_DECODERFANOUT_H_
+#define SRC_DECODERFANOUT_H_
+
+
+#include "ProtocolDecoder.h"
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#define FANOUT_HISTORY_RUNS 128	// Runs of the square wave replayed to a decoder when it wakes, well over any sync sequence
+
+
+/*
+ * Hands the BB square wave of one pipeline to several protocol decoders, so the filters run once.
+ * A decoder sleeps until the symbols read from the run lengths of the square wave end in the sync levels
+ * of its SyncPrematch, which costs a compare and a shift per edge. It is then woken by replaying the runs
+ * it missed, up to FANOUT_HISTORY_RUNS runs and the replay_len of its prematch, so it finds the same sync
+ * sequence, and fed every sample until its frame ends. Its frames decode exactly as if it had never slept.
+ */
+class DecoderFanout {
+public:
+	void add(ProtocolDecoder* decoder);	// Not owned, before samples are pushed
+	std::shared_ptr<SensorMessage> push(const bool& sample, std::shared_ptr<SensorMessage> sensor_message = nullptr);	// Passes on a message decoded outside the fanout first
+	bool receiving() const {return framing && framing->receiving();};	// True while any decoder is receiving a frame
+	ProtocolDecoder* getFraming() const {return framing;};	// Decoder of the most recent frame, nullptr before the first
+private:
+	struct Run {
+		bool level;
+		unsigned int len;
+	};
+	struct Slot {
+		ProtocolDecoder* decoder;
+		SyncPrematch prematch;
+		unsigned int pending_len;	// Of glitches, counted toward the next run
+		unsigned long int levels;	// Of the symbols read so far, the last in bit 0
+		bool awake;
+		unsigned long long int seen_runs;	// Runs fed to the decoder before it last slept
+	};
+	void endRun();
+	void wake(Slot& slot);
+	void pass(std::shared_ptr<SensorMessage>& sensor_message, std::shared_ptr<SensorMessage> decoded);
+	std::vector<Slot> slots;
+	unsigned int awake_decoders {0};
+	std::array<Run, FANOUT_HISTORY_RUNS> history {};
+	unsigned int history_front {0};	// Oldest run
+	unsigned long long int runs {0};	// Ended so far
+	bool level {};
+	unsigned int run_len {};
+	ProtocolDecoder* framing {nullptr};	// Decoder of the most recent frame
+	std::deque<std::shared_ptr<SensorMessage>> held;	// Messages completed on a sample that already had one, or while replaying, returned one per sample
+};
+
+
+#endif /* SRC_DECODERFANOUT_H_ */
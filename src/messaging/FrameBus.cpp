@@ -0,0 +1,55 @@
+#include "FrameBus.h"
+
+
+FrameBus::FrameBus(const FramePolicy& policy, const size_t& capacity) : queue(capacity), policy(policy) {}
+
+
+void FrameBus::push(std::shared_ptr<SensorMessage> frame) {
+	while (!queue.push(std::move(frame))) {	// A failed push leaves the frame in place
+		if (policy == FRAME_DROP_OLDEST) {
+			std::shared_ptr<SensorMessage> oldest;
+			if (queue.pop(oldest)) {
+				dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			continue;
+		}
+
+		blocked.fetch_add(1, std::memory_order_relaxed);
+		waiting_producers.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);	// Announced before the queue is checked, see wakeProducers()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			space_ready.wait_for(lock, std::chrono::milliseconds(FRAME_BUS_BLOCK_WAIT), [&]() {return queue.size() < queue.capacity();});
+		}
+		waiting_producers.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);	// Pushed before the consumer is checked, see wait()
+	if (waiting_consumer.load(std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> lock(mutex);
+		frames_ready.notify_one();
+	}
+}
+
+
+/*
+ * Either a waiting producer sees the slots just freed, or this sees that it is waiting and wakes it
+ */
+void FrameBus::wakeProducers() {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiting_producers.load(std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> lock(mutex);
+		space_ready.notify_all();
+	}
+}
+
+
+bool FrameBus::wait(const std::chrono::milliseconds& timeout) {
+	std::unique_lock<std::mutex> lock(mutex);
+	waiting_consumer.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);	// Announced before the queue is checked, see push()
+	bool ready = frames_ready.wait_for(lock, timeout, [&]() {return queue.size() > 0;});
+	waiting_consumer.store(false, std::memory_order_relaxed);
+
+	return ready;
+}
@@ -0,0 +1,84 @@
+#ifndef SRC_FRAMEBUS_H_
+#define SRC_FRAMEBUS_H_
+
+
+#include "SensorMessageReceiver.h"
+#include "../util/BoundedQueue.h"
+#include "../util/StatCounter.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#define FRAME_BUS_SIZE 4096	// Decoded frames buffered between the decoder threads and the tracker
+#define FRAME_BUS_BATCH 64	// Most frames taken off the bus by one drain()
+#define FRAME_BUS_BLOCK_WAIT 10	// Milliseconds a blocked decoder waits before checking for space again
+
+
+enum FramePolicy {
+	FRAME_DROP_OLDEST,	// A full bus makes room by dropping its oldest frame, decoders never wait
+	FRAME_BLOCK	// Decoders wait for room, no frame is lost
+};
+
+
+/*
+ * Hands decoded frames from any number of decoder threads to one tracker thread. Frames pass through
+ * a lock-free ring, the mutex is only taken to put a thread to sleep or wake it, and only while one
+ * is asleep. The consumer drains frames in batches, freeing their slots before it processes them.
+ * Counters written by the decoders and by the consumer are on separate cache lines.
+ */
+class FrameBus {
+public:
+	FrameBus(const FramePolicy& policy = FRAME_DROP_OLDEST, const size_t& capacity = FRAME_BUS_SIZE);
+	void push(std::shared_ptr<SensorMessage> frame);	// Any decoder thread
+	template <typename FUNC>
+	size_t drain(FUNC func);	// Consumer only, calls func(frame) for up to FRAME_BUS_BATCH frames, returns how many
+	bool wait(const std::chrono::milliseconds& timeout);	// Consumer only, returns early when frames arrive
+	FramePolicy getPolicy() const {return policy;};
+	unsigned long long int getDropped() const {return dropped.load(std::memory_order_relaxed);};	// Frames dropped to make room
+	unsigned long long int getBlocked() const {return blocked.load(std::memory_order_relaxed);};	// Times a decoder waited for room
+	unsigned long long int getFrames() const {return frames.get();};	// Frames drained
+	unsigned long long int getBatches() const {return batches.get();};
+private:
+	void wakeProducers();
+	BoundedQueue<std::shared_ptr<SensorMessage>> queue;
+	const FramePolicy policy;
+	alignas(CACHE_LINE_SIZE) std::atomic<unsigned long long int> dropped {0};	// Written by the decoders
+	std::atomic<unsigned long long int> blocked {0};
+	std::atomic<unsigned int> waiting_producers {0};
+	std::atomic<bool> waiting_consumer {false};
+	alignas(CACHE_LINE_SIZE) StatCounter frames;	// Written by the consumer
+	StatCounter batches;
+	std::mutex mutex;
+	std::condition_variable frames_ready;
+	std::condition_variable space_ready;
+};
+
+
+template <typename FUNC>
+size_t FrameBus::drain(FUNC func) {
+	std::array<std::shared_ptr<SensorMessage>, FRAME_BUS_BATCH> batch;
+	size_t count = 0;
+	while ((count < FRAME_BUS_BATCH) && queue.pop(batch[count])) {
+		count++;
+	}
+	if (!count) {
+		return 0;
+	}
+
+	frames.add(count);
+	batches.add();
+	wakeProducers();	// Before the batch is processed, so they can go on decoding meanwhile
+
+	for (size_t i = 0; i < count; i++) {
+		func(std::move(batch[i]));
+	}
+
+	return count;
+}
+
+
+#endif /* SRC_FRAMEBUS_H_ */
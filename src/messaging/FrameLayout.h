@@ -0,0 +1,149 @@
+#ifndef FRAMELAYOUT_H_
+#define FRAMELAYOUT_H_
+
+#include <array>
+
+#define CHANNEL_BITS 4
+#define HEADER_BITS 20
+#define INIT_HEADER_BITS 12
+#define DEVID_BITS 8
+#define STD_TXID_BITS 20
+#define STD_TXID_MASK ((0x1<<STD_TXID_BITS)-1)
+#define VIVINT_TXID_BITS 32
+#define SENSOR_STATE_BITS 8
+#define CRC_BITS 16
+
+
+enum Vendor {UNKNOWN, HONEYWELL, TWOGIG, VIVINT, VIVINT_INIT, NUM_VENDORS};	// Vivint sensors send messages over a different channel when they first power on (INIT)
+
+enum messageState {SYNC, CHANNEL, HEADER, TXID, SENSOR_STATE, CRC, DEVID};	// Receiver states, doubling as frame field identifiers
+
+
+/*
+ * Runtime view of a vendor frame layout, generated at compile time from a FrameLayout
+ */
+struct FrameField {
+	messageState field;
+	unsigned int bits;
+};
+
+struct FrameFormat {
+	Vendor vendor;
+	char16_t crc_poly;
+	bool raw_dump;	// Print the raw frame data on CRC pass, used for vendors with fields that are not yet understood
+	const FrameField* fields;	// Fields following the channel, terminated by the CRC field
+	unsigned int num_fields;
+	unsigned int data_bits;	// Channel and all fields covered by the CRC
+};
+
+
+template <messageState FIELD, unsigned int BITS>
+struct Field {
+	static_assert((FIELD != SYNC) & (FIELD != CHANNEL), "Sync and channel are common to all frames and precede the layout fields");
+	static_assert((BITS > 0) & (BITS <= 32), "Field does not fit in the Manchester decoder output");
+	static constexpr messageState field = FIELD;
+	static constexpr unsigned int bits = BITS;
+};
+
+
+template <unsigned int... CHANNELS>
+struct Channels {};
+
+
+/*
+ * Compile-time description of a vendor frame: the channels it is sent on, CRC parameters,
+ * and the sequence of fields that follow the channel
+ */
+template <Vendor VENDOR, typename CHANNEL_LIST, char16_t CRC_POLY, bool RAW_DUMP, typename... FIELDS>
+struct FrameLayout;
+
+template <Vendor VENDOR, unsigned int... CHANNELS, char16_t CRC_POLY, bool RAW_DUMP, typename... FIELDS>
+struct FrameLayout<VENDOR, Channels<CHANNELS...>, CRC_POLY, RAW_DUMP, FIELDS...> {
+	static constexpr Vendor vendor = VENDOR;
+	static constexpr std::array<unsigned int, sizeof...(CHANNELS)> channels {CHANNELS...};
+	static constexpr std::array<FrameField, sizeof...(FIELDS)> fields {FrameField {FIELDS::field, FIELDS::bits}...};
+	static constexpr unsigned int data_bits = CHANNEL_BITS + (FIELDS::bits + ...) - CRC_BITS;
+	static constexpr FrameFormat format {VENDOR, CRC_POLY, RAW_DUMP, fields.data(), sizeof...(FIELDS), data_bits};
+
+	static_assert(VENDOR < NUM_VENDORS, "Invalid vendor");
+	static_assert(((CHANNELS < (0x1<<CHANNEL_BITS)) && ...), "Channel out of range");
+	static_assert((fields.back().field == CRC) & (fields.back().bits == CRC_BITS), "Frames must end with the CRC");
+	static_assert(((FIELDS::field == CRC) + ...) == 1, "Frames must contain exactly one CRC");
+	static_assert(((FIELDS::field == TXID) + ...) == 1, "Frames must contain exactly one TXID");
+	static_assert(data_bits <= 64, "Frame data does not fit in the CRC data accumulator");
+};
+
+
+template <typename LAYOUT>
+constexpr void addChannels(std::array<Vendor, (0x1<<CHANNEL_BITS)>& map) {
+	for (auto channel : LAYOUT::channels) {
+		map[channel] = LAYOUT::vendor;
+	}
+}
+
+
+template <typename... LAYOUTS>
+constexpr std::array<Vendor, (0x1<<CHANNEL_BITS)> buildChannelMap() {
+	std::array<Vendor, (0x1<<CHANNEL_BITS)> map {};	// Unmapped channels default to UNKNOWN
+	(addChannels<LAYOUTS>(map), ...);
+	return map;
+}
+
+
+template <typename... LAYOUTS>
+constexpr std::array<const FrameFormat*, NUM_VENDORS> buildFrameFormats() {
+	std::array<const FrameFormat*, NUM_VENDORS> formats {};
+	((formats[LAYOUTS::vendor] = &LAYOUTS::format), ...);
+	return formats;
+}
+
+
+constexpr unsigned int countMappedChannels(const std::array<Vendor, (0x1<<CHANNEL_BITS)>& map) {
+	unsigned int mapped = 0;
+	for (auto vendor : map) {
+		mapped += (vendor != UNKNOWN);
+	}
+	return mapped;
+}
+
+
+/*
+ * Collects the layouts of all known vendors, generating the channel to vendor map and the
+ * per-vendor frame format lookup used to select a parser once per frame
+ */
+template <typename... LAYOUTS>
+struct VendorRegistry {
+	static constexpr std::array<Vendor, (0x1<<CHANNEL_BITS)> channel_map = buildChannelMap<LAYOUTS...>();
+	static constexpr std::array<const FrameFormat*, NUM_VENDORS> formats = buildFrameFormats<LAYOUTS...>();
+
+	static_assert(sizeof...(LAYOUTS) == NUM_VENDORS, "Each vendor requires exactly one layout");
+	static_assert(((formats[LAYOUTS::vendor] == &LAYOUTS::format) & ...), "Each vendor requires exactly one layout");
+	static_assert((LAYOUTS::channels.size() + ...) == countMappedChannels(channel_map), "Channels may only be assigned to one known vendor");
+};
+
+
+/*
+ * VENDOR FRAME LAYOUTS
+ * To add a vendor, add it to the Vendor enum, describe its layout here, and register it in Vendors
+ */
+typedef FrameLayout<UNKNOWN, Channels<>, 0x8005, false,	// Default Honeywell parameters, may cause CRC failure
+		Field<TXID, STD_TXID_BITS>, Field<SENSOR_STATE, SENSOR_STATE_BITS>, Field<CRC, CRC_BITS>> UnknownFrame;
+
+typedef FrameLayout<HONEYWELL, Channels<8>, 0x8005, false,
+		Field<TXID, STD_TXID_BITS>, Field<SENSOR_STATE, SENSOR_STATE_BITS>, Field<CRC, CRC_BITS>> HoneywellFrame;
+
+typedef FrameLayout<TWOGIG, Channels<2, 9, 10>, 0x8050, false,
+		Field<TXID, STD_TXID_BITS>, Field<SENSOR_STATE, SENSOR_STATE_BITS>, Field<CRC, CRC_BITS>> TwoGigFrame;
+
+typedef FrameLayout<VIVINT, Channels<7>, 0x8005, true,	// TODO: Determine real CRC parameters used
+		Field<HEADER, HEADER_BITS>, Field<SENSOR_STATE, SENSOR_STATE_BITS>, Field<TXID, VIVINT_TXID_BITS>, Field<CRC, CRC_BITS>> VivintFrame;
+
+typedef FrameLayout<VIVINT_INIT, Channels<13>, 0x8050, true,
+		Field<HEADER, INIT_HEADER_BITS>, Field<DEVID, DEVID_BITS>, Field<SENSOR_STATE, SENSOR_STATE_BITS>, Field<TXID, VIVINT_TXID_BITS>, Field<CRC, CRC_BITS>> VivintInitFrame;
+
+typedef VendorRegistry<UnknownFrame, HoneywellFrame, TwoGigFrame, VivintFrame, VivintInitFrame> Vendors;
+
+static constexpr const auto& vendor_channel_map = Vendors::channel_map;	// A map of channel numbers to the associated vendors
+
+
+#endif /* FRAMELAYOUT_H_ */
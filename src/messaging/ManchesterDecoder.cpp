@@ -34,6 +34,7 @@ void ManchesterDecoder::add(const bool& symbol_state) {
 			 *		state and try decoding first_state with the next state
 			 *	This assumption will be verified by CRC later
 			 */
+			error_count++;
 			return;	// Output data not yet processed and shifted in
 		}
 
@@ -12,10 +12,13 @@ public:
 	const unsigned long int pop_all();
 	void clear();
 	const unsigned int size() const;
+	const unsigned int errors() const {return error_count;};	// Invalid sequences skipped since clearErrors()
+	void clearErrors() {error_count = 0;};
 private:
 	unsigned char first_state {0xFF};	// 0xFF is an indicator that the variable is unset
 	unsigned long int output_data {};
 	unsigned int output_size {};
+	unsigned int error_count {};
 };
 
 
@@ -0,0 +1,44 @@
+#ifndef SRC_PROTOCOLDECODER_H_
+#define SRC_PROTOCOLDECODER_H_
+
+
+#include "FrameLayout.h"
+
+#include <memory>
+
+
+class SensorMessage;
+
+enum FrameOutcome {FRAME_REJECTED, FRAME_PASSED, FRAME_FAILED};	// Rejected on an invalid channel or field, or passed or failed the CRC
+
+
+/*
+ * Sync sequence of a protocol, as symbol levels read from the run lengths of the square wave the way
+ * its decoder reads them while waiting for one, used to wake that decoder
+ */
+struct SyncPrematch {
+	unsigned int min_len;	// Samples, shorter runs are glitches and count toward the following run
+	unsigned int max_len;	// Samples of a run of one symbol, longer runs are two, Manchester coding allows no more
+	unsigned long int levels;	// Symbol levels of the sync sequence, the last in bit 0
+	unsigned long int mask;	// Of the levels compared
+	unsigned int replay_len;	// Samples before waking that the decoder's state depends on, at least its longest sync sequence
+};
+
+
+/*
+ * Decoder of one OOK sensor protocol, fed the BB square wave one sample at a time by a DecoderFanout.
+ * A decoder is only fed while it is awake, from the last replay_len samples before its sync sequence ended on,
+ * so its state must not depend on samples older than those.
+ */
+class ProtocolDecoder {
+public:
+	virtual ~ProtocolDecoder() {};
+	virtual std::shared_ptr<SensorMessage> push(const bool& sample) = 0;
+	virtual bool receiving() const = 0;	// True while a frame is being received after its sync sequence
+	virtual FrameOutcome getOutcome() const = 0;	// How the most recent frame ended, once receiving() is false again
+	virtual Vendor getFrameVendor() const = 0;	// Of the most recent frame
+	virtual SyncPrematch getPrematch() const = 0;
+};
+
+
+#endif /* SRC_PROTOCOLDECODER_H_ */
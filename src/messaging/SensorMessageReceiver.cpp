@@ -1,7 +1,7 @@
 #include "SensorMessageReceiver.h"
 
+#include <cmath>
 #include <iostream>
-#include <iomanip>
 
 
 std::shared_ptr<SensorMessage> SensorMessageReceiver::push(const bool& sample) {
@@ -32,7 +32,11 @@ std::shared_ptr<SensorMessage> SensorMessageReceiver::push(const bool& sample) {
 					// Determine the pulse width for this transmitter to read following bits
 					// Last pulse(s) are double width due to 0xFFFE pattern, ignore them
 					symbol_len_tracker.computeSyncAvg();
+					manchester_decoder.clearErrors();
 					message_state = CHANNEL;
+					outcome = FRAME_REJECTED;	// Until the CRC is checked
+					frame_format = nullptr;	// Until the channel is known
+					stats.synced.add();
 				}
 
 				break;
@@ -44,128 +48,75 @@ std::shared_ptr<SensorMessage> SensorMessageReceiver::push(const bool& sample) {
 					if (channel < (0x1<<CHANNEL_BITS)) {	// Check bounds of valid channels
 						sensor_message = std::make_shared<SensorMessage>(channel);	// Determine vendor based on known correlations of vendors to specific channels
 					} else {
-						std::cerr << channel << " is not a valid channel. Channels range from 0-" << (0x1<<CHANNEL_BITS)-1 << "." << std::endl;
+						OutputEvent event {UNKNOWN_CHANNEL};	// Reported rather than printed, the receiver does no console I/O
+						event.count = channel;
+						emit(event);
+						stats.rejected.add();
 						resetToSync();
 						break;
 					}
 
-					// Configure CRC checker to settings used by the vendor
-					crc16.reset();
-					switch (sensor_message->getVendor()) {
-					case TWOGIG:
-						crc16.setPoly(0x8050);
-						message_state = TXID;
-						break;
-					case VIVINT:
-						// TODO: Determine real CRC parameters used
-						crc16.setPoly(0x8005);
-						message_state = HEADER;
-						break;
-					case VIVINT_INIT:
-						crc16.setPoly(0x8050);
-						message_state = HEADER;
-						break;
-					case UNKNOWN:
-						std::cout << std::endl;
-						std::cout << "No known vendor uses channel " << channel << ", may cause CRC failure." << std::endl;
-					default:
-						crc16.setPoly(0x8005);	// Default Honeywell parameters
-						message_state = TXID;
+					// Select the frame layout and CRC settings used by the vendor, once per frame
+					frame_format = Vendors::formats[sensor_message->getVendor()];
+					if (frame_format->vendor == UNKNOWN) {
+						OutputEvent event {UNKNOWN_CHANNEL};
+						event.count = channel;
+						emit(event);
 					}
-					crc16.push(channel, CHANNEL_BITS);
-				}
 
-				break;
-			case HEADER:
-				manchester_decoder.add(symbol_state);
+					crc16.reset();
+					crc16.setPoly(frame_format->crc_poly);
+					crc16.push(channel, CHANNEL_BITS);
 
-				if (manchester_decoder.size() == HEADER_BITS) {
-					message_state = SENSOR_STATE;
-				} else if ((sensor_message->getVendor() == VIVINT_INIT) & (manchester_decoder.size() == INIT_HEADER_BITS)) {
-					message_state = DEVID;
-				} else {
-					break;
+					frame_field = frame_format->fields;
+					message_state = frame_field->field;
 				}
 
-				{
-					auto num_devid_bits = manchester_decoder.size();
-					sensor_message->header = manchester_decoder.pop_all();
-					crc16.push(sensor_message->getHeader(), num_devid_bits);
-				}
 				break;
+			case HEADER:
 			case DEVID:
-				manchester_decoder.add(symbol_state);
-
-				if (manchester_decoder.size() == DEVID_BITS) {
-					sensor_message->devid = manchester_decoder.pop_all();
-					crc16.push(sensor_message->getDEVID(), DEVID_BITS);
-
-					message_state = SENSOR_STATE;
-				}
-
-				break;
 			case TXID:
+			case SENSOR_STATE:
 				manchester_decoder.add(symbol_state);
 
-				// Wait for all TXID bits
-				if (manchester_decoder.size() < STD_TXID_BITS) {
-					break;
-				} else if ((sensor_message->getVendor() == VIVINT) | (sensor_message->getVendor() == VIVINT_INIT)) {
-					if (manchester_decoder.size() != VIVINT_TXID_BITS) {
-						break;
-					}
-
-					// The vendor is VIVINT and all expected TXID bits have been received
-					message_state = CRC;
-				} else {
-					// The vendor is not VIVINT and all expected TXID bits have been received
-					message_state = SENSOR_STATE;
-				}
-
-				{
-					auto num_txid_bits = manchester_decoder.size();
-					sensor_message->txid = manchester_decoder.pop_all();
-
-					if (!sensor_message->getTXID()) {	// Invalid TXID, reset and wait for next message
+				// Wait for all bits of this field, as defined by the vendor frame layout
+				if (manchester_decoder.size() == frame_field->bits) {
+					auto field_data = manchester_decoder.pop_all();
+					if (!storeField(field_data)) {	// Invalid field, reset and wait for next message
+						stats.rejected.add();
 						resetToSync();
 						break;
 					}
 
-					crc16.push(sensor_message->getTXID(), num_txid_bits);
-				}
-
-				break;
-			case SENSOR_STATE:
-				manchester_decoder.add(symbol_state);
-
-				if (manchester_decoder.size() == SENSOR_STATE_BITS) {
-					sensor_message->sensor_state = manchester_decoder.pop_all();
-					crc16.push(sensor_message->getState(), SENSOR_STATE_BITS);
-
-					if ((sensor_message->getVendor() == VIVINT) | (sensor_message->getVendor() == VIVINT_INIT)) {
-						message_state = TXID;
-					} else {
-						message_state = CRC;
-					}
+					crc16.push(field_data, frame_field->bits);
+					message_state = (++frame_field)->field;	// Layouts always end with the CRC field
 				}
 
 				break;
 			case CRC:
 				manchester_decoder.add(symbol_state);
 
-				if (manchester_decoder.size() == CRC_BITS) {
+				if (manchester_decoder.size() == frame_field->bits) {
 					// Verify CRC
 					char16_t rx_crc = manchester_decoder.pop_all();
+					stats.manchester_errors.add(manchester_decoder.errors());
 					if (rx_crc == crc16.getCRC()) {
+						stats.crc_pass[frame_format->vendor].add();
+						outcome = FRAME_PASSED;
 						// Temporarily print Vivint sensor message hex data for analysis
 						// CRC parameters are known for init messages, but not the regular status messages. The data fields are different and not yet understood so don't
 						// declare the message ready for external processing
-						if ((sensor_message->getVendor() == VIVINT) | (sensor_message->getVendor() == VIVINT_INIT)) {
-							std::cout << "VIVINT SENSOR MESSAGE: 0x";
-							std::cout << std::setfill('0') << std::setw((CHANNEL_BITS+HEADER_BITS+VIVINT_TXID_BITS+SENSOR_STATE_BITS)/4)
-										<< std::hex << crc16.getData() << std::dec << std::endl;
+						if (frame_format->raw_dump) {
+							OutputEvent event {RAW_FRAME};
+							event.vendor = frame_format->vendor;
+							event.data = crc16.getData();
+							event.count = frame_format->data_bits;
+							emit(event);
 						}
 
+						sensor_message->manchester_errors = manchester_decoder.errors();
+						sensor_message->latency_stamps.decoded = latencyClock();
+
 						symbol_len_tracker.newSymbol();
 						symbol_state = sample;
 
@@ -176,7 +127,15 @@ std::shared_ptr<SensorMessage> SensorMessageReceiver::push(const bool& sample) {
 												// By returning here, a bit may be lost from the next message if it
 												// follows directly behind this one, but the likelihood is negligible
 					} else {
-						std::cout << "CRC FAIL FOR DATA 0x" << std::hex << crc16.getData() << " AND RX CRC 0x" << rx_crc << " WITH COMPUTED CRC 0x" << crc16.getCRC() << std::dec << std::endl;
+						stats.crc_fail[frame_format->vendor].add();
+						outcome = FRAME_FAILED;
+						OutputEvent event {CRC_FAIL};
+						event.vendor = frame_format->vendor;
+						event.data = crc16.getData();
+						event.count = frame_format->data_bits;
+						event.rx_crc = rx_crc;
+						event.calc_crc = crc16.getCRC();
+						emit(event);
 					}
 
 					resetToSync();	// Reset and wait for next message
@@ -194,3 +153,42 @@ std::shared_ptr<SensorMessage> SensorMessageReceiver::push(const bool& sample) {
 
 	return std::shared_ptr<SensorMessage>(nullptr);
 }
+
+
+/*
+ * Stores a completed frame field in the message being received, returns false if the field is invalid
+ */
+bool SensorMessageReceiver::storeField(const unsigned long int& field_data) {
+	switch (frame_field->field) {
+		case HEADER:
+			sensor_message->header = field_data;
+			break;
+		case DEVID:
+			sensor_message->devid = field_data;
+			break;
+		case TXID:
+			sensor_message->txid = field_data;
+			if (!sensor_message->getTXID()) {	// Invalid TXID
+				return false;
+			}
+			break;
+		case SENSOR_STATE:
+			sensor_message->sensor_state = field_data;
+			break;
+		default:
+			std::cerr << "Decode345 frame layout contains unexpected field " << frame_field->field << std::endl;
+			throw 1;
+	}
+
+	return true;
+}
+
+
+/*
+ * The sync levels as push() reads them while waiting for a sync sequence, with symbols rounded from the estimated
+ * symbol length. Runs of up to half a symbol are counted into the following symbol, runs over one and a half are two.
+ */
+SyncPrematch SensorMessageReceiver::getPrematch() const {
+	return {(unsigned int)(est_symbol_len/2) + 1, (unsigned int)(1.5f*est_symbol_len), SYNC_LEVELS_FORMAT, SYNC_LEVEL_MASK,
+			(unsigned int)std::lround(SYNC_REPLAY_SYMBOLS*est_symbol_len)};
+}
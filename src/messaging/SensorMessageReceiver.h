@@ -6,30 +6,25 @@
 #include "SymbolLenTracker.h"
 #include "ManchesterDecoder.h"
 #include "CRC16.h"
+#include "FrameLayout.h"
+#include "ProtocolDecoder.h"
+#include "../output/OutputEvent.h"
+#include "../util/LatencyHistogram.h"
+#include "../util/StatCounter.h"
+
+#include <array>
+#include <cmath>
 
 #define SYNC_LEN 32-2	// Length of sync sequence with manchester encoding shortened due to two ignored sync bits
 #define SYNC_LEVELS_FORMAT 0x55555556	// Sync sequence with manchester encoding
 #define SYNC_LEVEL_MASK 0x3FFFFFFF	// First couple bits are inconsistent on some sensors
-
-#define CHANNEL_BITS 4
-#define HEADER_BITS 20
-#define INIT_HEADER_BITS 12
-#define DEVID_BITS 8
-#define STD_TXID_BITS 20
-#define STD_TXID_MASK ((0x1<<STD_TXID_BITS)-1)
-#define VIVINT_TXID_BITS 32
-#define SENSOR_STATE_BITS 8
-#define CRC_BITS 16
-
-
-enum Vendor {UNKNOWN, HONEYWELL, TWOGIG, VIVINT, VIVINT_INIT};	// Vivint sensors send messages over a different channel when they first power on (INIT)
-static const Vendor vendor_channel_map[0x1<<CHANNEL_BITS] = {	// A map of channel numbers to the associated vendors
-		UNKNOWN, UNKNOWN, TWOGIG, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, VIVINT,
-		HONEYWELL, TWOGIG, TWOGIG, UNKNOWN, UNKNOWN, VIVINT_INIT, UNKNOWN, UNKNOWN};
+#define NO_RSSI -200	// dBFS, signal strength was not measured
+#define SYNC_REPLAY_SYMBOLS 64	// Symbols replayed when woken, twice the sync sequence, whose runs are one symbol but the 0b11
 
 
 class SensorMessage {
 	friend class SensorMessageReceiver;
+	friend class DecodePipeline;
 public:
 	SensorMessage(const unsigned char& channel): vendor(vendor_channel_map[channel]) {};
 	Vendor getVendor() const {return vendor;}
@@ -37,33 +32,71 @@ public:
 	unsigned char getDEVID() const {return devid;};
 	unsigned long int getTXID() const {return txid;};
 	unsigned char getState() const {return sensor_state;};
+	unsigned int getManchesterErrors() const {return manchester_errors;};	// Signal quality, fewer skipped Manchester sequences is better
+	unsigned char getReceiver() const {return receiver;};	// Radio that decoded this message
+	float getRSSI() const {return rssi;};	// Mean pulse power at the receiver, dB relative to full scale
+	float getFreqOffset() const {return freq_offset;};	// Carrier offset from SIG_FREQ in Hz, NAN when not measured
+	long long int getTime() const {return time;};	// When the frame's sync sequence ended at the antenna, ns since the Unix epoch
+	const LatencyStamps& getLatencyStamps() const {return latency_stamps;};
 private:
 	const Vendor vendor;
 	unsigned long int header {};
 	unsigned char devid {};
 	unsigned long int txid {};
 	unsigned char sensor_state {};
+	unsigned int manchester_errors {};
+	unsigned char receiver {};
+	float rssi {NO_RSSI};
+	float freq_offset {NAN};
+	long long int time {};
+	LatencyStamps latency_stamps {};
 };
 
 
-enum messageState {SYNC, CHANNEL, HEADER, TXID, SENSOR_STATE, CRC, DEVID};
+/*
+ * Frame counters of one receiver, these count events rare enough to be kept at all times
+ */
+struct alignas(CACHE_LINE_SIZE) ReceiverStats {
+	StatCounter synced;	// Sync sequences found
+	StatCounter rejected;	// Frames abandoned on an invalid channel or field
+	std::array<StatCounter, NUM_VENDORS> crc_pass;
+	std::array<StatCounter, NUM_VENDORS> crc_fail;
+	StatCounter manchester_errors;	// Skipped Manchester sequences in frames that reached their CRC
+};
 
 
-class SensorMessageReceiver {
+/*
+ * Decoder of Honeywell, 2GIG and Vivint 345 MHz frames. Its state while waiting for a sync sequence
+ * only depends on the last SYNC_LEN symbols, so it can sleep between sync sequences.
+ */
+class SensorMessageReceiver : public ProtocolDecoder {
 public:
-	SensorMessageReceiver(const float& est_symbol_len) :
-		symbol_len_tracker(SymbolLenTracker<unsigned int>(SYNC_LEN-1, est_symbol_len)) {};
+	SensorMessageReceiver(const float& est_symbol_len, EventSink* event_sink = nullptr) :
+		symbol_len_tracker(SymbolLenTracker<unsigned int>(SYNC_LEN-1, est_symbol_len)), est_symbol_len(est_symbol_len), event_sink(event_sink) {};
 					// -1 slot is required because 11b in the manchester sync sequence only takes 1 slot
-	std::shared_ptr<SensorMessage> push(const bool& sample);
+	std::shared_ptr<SensorMessage> push(const bool& sample) override;
+	bool receiving() const override {return message_state != SYNC;};
+	const ReceiverStats& getStats() const {return stats;};
+	FrameOutcome getOutcome() const override {return outcome;};
+	Vendor getFrameVendor() const override {return frame_format ? frame_format->vendor : UNKNOWN;};
+	SyncPrematch getPrematch() const override;
 private:
 	void resetToSync() {message_state = SYNC; symbol_len_tracker.resetSyncAvg(); sensor_message.reset();};
+	bool storeField(const unsigned long int& field_data);
+	void emit(const OutputEvent& event) const {if (event_sink) event_sink->emit(event);};
 	bool symbol_state {};
 	unsigned int rx_sync_sr {};
 	SymbolLenTracker<unsigned int> symbol_len_tracker;	// Shortened window size due to ignored sync bits
+	const float est_symbol_len;
 	ManchesterDecoder manchester_decoder;
 	CRC16 crc16;
 	messageState message_state {SYNC};
+	const FrameFormat* frame_format {nullptr};	// Layout of the current frame, selected once per frame by vendor
+	const FrameField* frame_field {nullptr};	// Field of the current frame being received
 	std::shared_ptr<SensorMessage> sensor_message;
+	FrameOutcome outcome {FRAME_REJECTED};
+	EventSink* const event_sink;	// Reports are discarded when there is no sink
+	ReceiverStats stats;
 };
 
 #endif /* SENSORMESSAGERECEIVER_H_ */
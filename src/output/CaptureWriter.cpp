@@ -0,0 +1,98 @@
+#include "CaptureWriter.h"
+#include "EventWriter.h"
+#include "../dsp/DecodePipeline.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+CaptureWriter::CaptureWriter(const std::string& directory) : directory(directory), queue(CAPTURE_QUEUE_SIZE) {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (!std::filesystem::is_directory(directory, error)) {
+		throw CAPTURE_DIR_FAILED;
+	}
+
+	writer_thread = std::thread(&CaptureWriter::run, this);
+}
+
+
+CaptureWriter::~CaptureWriter() {
+	running.store(false, std::memory_order_release);
+	writer_thread.join();
+
+	if (written | failed | dropped.load()) {
+		std::cerr << written << " IQ CAPTURES WRITTEN TO \"" << directory << "\"";
+		if (failed | dropped.load()) {
+			std::cerr << ", " << failed << " FAILED, " << dropped.load() << " DROPPED";
+		}
+		std::cerr << std::endl;
+	}
+}
+
+
+void CaptureWriter::write(std::unique_ptr<Capture> capture) {
+	if (!queue.push(std::move(capture))) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+
+void CaptureWriter::run() {
+	while (running.load(std::memory_order_acquire)) {
+		if (!drain()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(CAPTURE_IDLE_SLEEP));
+		}
+	}
+
+	while (drain());	// Write anything queued before shutdown
+}
+
+
+/*
+ * Saves all queued captures, returns false if there was nothing to save
+ */
+bool CaptureWriter::drain() {
+	std::unique_ptr<Capture> capture;
+	bool saved = false;
+	while (queue.pop(capture)) {
+		save(*capture);
+		saved = true;
+	}
+
+	return saved;
+}
+
+
+/*
+ * Writes <start time>-rx<receiver>-<trigger>.cs8 and its .json sidecar
+ */
+void CaptureWriter::save(const Capture& capture) {
+	std::ostringstream name;
+	name << capture.start_time << "-rx" << (unsigned int)capture.receiver << "-" << capture.trigger;
+	auto path = std::filesystem::path(directory) / name.str();
+
+	std::ofstream samples_file(path.string() + ".cs8", std::ios::out | std::ios::binary);
+	samples_file.write((const char*)capture.samples.data(), capture.samples.size());
+
+	std::ofstream sidecar_file(path.string() + ".json");
+	sidecar_file << "{\"samples\":\"" << name.str() << ".cs8\",\"format\":\"cs8\",\"sample_rate\":" << (unsigned int)SAMP_RATE
+			<< ",\"center_freq\":" << (unsigned long int)(SIG_FREQ+TUNE_FREQ_OFFSET) << ",\"receiver\":" << (unsigned int)capture.receiver
+			<< ",\"trigger\":\"" << capture.trigger << "\",\"vendor\":\"" << vendorName(capture.vendor) << "\"";
+	if (capture.txid) {
+		sidecar_file << ",\"txid\":" << capture.txid << ",\"txid_str\":\"";
+		printTXID(sidecar_file, capture.vendor, capture.txid) << "\"";
+	}
+	sidecar_file << ",\"start_time\":" << capture.start_time / NS_PER_SEC << "." << std::setfill('0') << std::setw(9) << capture.start_time % NS_PER_SEC
+			<< ",\"frame_start\":" << capture.frame_start << ",\"frame_end\":" << capture.frame_end << "}" << std::endl;
+
+	if (samples_file && sidecar_file) {
+		written++;
+	} else {
+		failed++;
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef SRC_CAPTUREWRITER_H_
+#define SRC_CAPTUREWRITER_H_
+
+
+#include "../messaging/FrameLayout.h"
+#include "../util/BoundedQueue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CAPTURE_QUEUE_SIZE 64	// Captures buffered between the decoders and the writer thread
+#define CAPTURE_IDLE_SLEEP 20	// Milliseconds the writer thread sleeps when there is nothing to write
+
+#define CAPTURE_SYNC 0x1	// Trigger on every frame whose sync sequence was found
+#define CAPTURE_PASS 0x2	// Trigger on frames that pass their CRC
+#define CAPTURE_FAIL 0x4	// Trigger on frames that fail their CRC
+
+
+enum CaptureError {CAPTURE_DIR_FAILED};
+
+
+/*
+ * Raw IQ around one frame, as CS8 (interleaved signed 8-bit I and Q, full scale 127)
+ */
+struct Capture {
+	unsigned char receiver;
+	const char* trigger;	// Why the frame was captured
+	Vendor vendor;
+	unsigned long int txid;	// Only known for frames that passed their CRC, 0 otherwise
+	long long int start_time;	// Of the first sample, ns since the Unix epoch
+	size_t frame_start;	// Samples into the capture at which the frame's sync sequence ended
+	size_t frame_end;	// Samples into the capture at which the frame ended
+	std::vector<int8_t> samples;
+};
+
+
+/*
+ * Writes captures to a directory on a separate thread, so the decoders never wait on the disk.
+ * Each capture is a .cs8 sample file with a .json sidecar describing it. Captures are dropped
+ * (and counted) if the queue fills up because the disk cannot keep up.
+ */
+class CaptureWriter {
+public:
+	CaptureWriter(const std::string& directory);	// Created if it does not exist
+	~CaptureWriter();	// Writes all queued captures before returning
+	void write(std::unique_ptr<Capture> capture);	// Called from the decode path, never blocks
+private:
+	void run();
+	bool drain();
+	void save(const Capture& capture);
+	const std::string directory;
+	BoundedQueue<std::unique_ptr<Capture>> queue;
+	std::atomic<bool> running {true};
+	std::atomic<unsigned long long int> dropped {0};
+	unsigned long long int written {0};	// Writer thread only
+	unsigned long long int failed {0};
+	std::thread writer_thread;
+};
+
+
+#endif /* SRC_CAPTUREWRITER_H_ */
@@ -0,0 +1,342 @@
+#include "EventWriter.h"
+
+#include <cmath>
+#include <iomanip>
+#include <chrono>
+#include <string>
+
+
+static const std::string status_bit_states[SENSOR_STATE_BITS][3] = {
+		{"CLOSED", "OPEN", "LOOP ONE"},	// False state, True state, Name
+		{"NORM", "TRIP", "TAMPER"},
+		{"CLOSED", "OPEN", "LOOP TWO"},
+		{"FALSE", "TRUE", "UNKb4"},
+		{"NORM", "LOW", "BATTERY"},
+		{"EVENT", "PERIODIC", "TRIGGER"},
+		{"FALSE", "TRUE", "PAIR"},
+		{"FALSE", "TRUE", "UNKb0"}
+};
+
+static const char* vendor_names[NUM_VENDORS] = {"UNKNOWN", "HONEYWELL", "2GIG", "VIVINT", "VIVINT_INIT"};
+
+
+std::ostream& printTXID(std::ostream& out, const Vendor& vendor, const unsigned long int& txid) {
+	if ((vendor == VIVINT_INIT) | (vendor == VIVINT)) {
+		out << std::setfill('0') << std::setw(4) << (txid>>STD_TXID_BITS) << "-";	// Print extra Vivint-specific leading TXID field
+	}
+
+	// Strip extra Vivint TXID field and print remaining fields as normal
+	out << std::setfill('0') << std::setw(3) << ((txid & STD_TXID_MASK)/10000);
+	out << "-" << std::setw(4) << ((txid & STD_TXID_MASK)%10000);
+
+	return out;
+}
+
+
+const char* vendorName(const Vendor& vendor) {
+	return vendor_names[vendor];
+}
+
+
+static const char* deviceName(const unsigned char& devid) {
+	switch (devid) {
+	case 0x18:
+		return "DW11";
+	case 0x0f:
+		return "DW21R";
+	case 0x14:
+		return "GB2";
+	case 0x0a:
+		return "PIR2";
+	default:
+		return "UNKNOWN";
+	}
+}
+
+
+static const char* asciiTime(const long long int& time) {	// Includes a trailing newline
+	time_t seconds = time / NS_PER_SEC;
+	return std::asctime(std::localtime(&seconds));
+}
+
+
+static std::ostream& printTime(std::ostream& out, const long long int& time) {	// Seconds since the Unix epoch, to the ns
+	return out << time / NS_PER_SEC << "." << std::setfill('0') << std::setw(9) << time % NS_PER_SEC;
+}
+
+
+/*
+ * Prints a description of each state bit
+ */
+static void printState(std::ostream& out, const unsigned char& sensor_state) {
+	unsigned int i = 1;
+	for (auto bit_state : status_bit_states) {
+		out << bit_state[2] << ": "; // Output bit descriptor
+		// Output state description
+		out << bit_state[sensor_state>>(SENSOR_STATE_BITS-i) & 0x1] << std::endl;
+
+		i++;	// Next bit
+	}
+}
+
+
+/*
+ * Prints a summary of differences between two states
+ */
+static void printStatusDiff(std::ostream& out, const unsigned char& former_state, const unsigned char& cur_state) {
+	unsigned int i = 1;
+	for (auto bit_state : status_bit_states) {
+		bool former_bit = (former_state>>(SENSOR_STATE_BITS-i)) & 0x1;
+		bool cur_bit = (cur_state>>(SENSOR_STATE_BITS-i)) & 0x1;
+		if (former_bit != cur_bit) {
+			out << bit_state[2] << ": ";	// Output bit descriptor
+			// Output change description
+			out	<< bit_state[former_bit] << "->"
+				<< bit_state[cur_bit] << std::endl;
+		}
+
+		i++;	// Next bit
+	}
+}
+
+
+EventWriter::EventWriter(const OutputFormat& format, std::ostream& output) : format(format), output(output), queue(EVENT_QUEUE_SIZE) {
+	if (format == BINARY) {
+		output.write(BINARY_MAGIC, sizeof(BINARY_MAGIC)-1);
+	}
+
+	writer_thread = std::thread(&EventWriter::run, this);
+}
+
+
+EventWriter::~EventWriter() {
+	running.store(false, std::memory_order_release);
+	writer_thread.join();
+
+	if (getDropCount()) {
+		std::cerr << getDropCount() << " OUTPUT EVENTS DROPPED" << std::endl;
+	}
+}
+
+
+/*
+ * Called from the decode path, never blocks
+ */
+void EventWriter::emit(const OutputEvent& event) {
+	if (!queue.push(event)) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+
+/*
+ * Called from the tracker for summary and eviction reports, waits while the queue is full
+ */
+void EventWriter::emitBlocking(const OutputEvent& event) {
+	while (!queue.push(event)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_FULL_WAIT));
+	}
+}
+
+
+void EventWriter::run() {
+	while (running.load(std::memory_order_acquire)) {
+		if (!drain()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_IDLE_SLEEP));
+		}
+	}
+
+	while (drain());	// Write anything queued before shutdown
+}
+
+
+/*
+ * Formats all queued events and writes them at once, returns false if there was nothing to write
+ */
+bool EventWriter::drain() {
+	OutputEvent event;
+	size_t num_events = 0;
+	while ((num_events < queue.capacity()) && queue.pop(event)) {
+		switch (format) {
+		case JSON:
+			formatJSON(event);
+			break;
+		case BINARY:
+			formatBinary(event);
+			break;
+		default:
+			formatText(event);
+		}
+
+		num_events++;
+	}
+
+	if (!num_events) {
+		return false;
+	}
+
+	auto formatted = batch.str();
+	output.write(formatted.data(), formatted.size());
+	output.flush();
+	batch.str("");
+
+	return true;
+}
+
+
+void EventWriter::formatText(const OutputEvent& event) {
+	switch (event.type) {
+	case SENSOR_ADD:
+		batch << std::endl << "## ADD " << deviceName(event.devid) << " SENSOR ";
+		printTXID(batch, event.vendor, event.txid) << " ##" << std::endl;
+		batch << "SEEN " << event.count << " TIMES, NOW " << asciiTime(event.time);
+		printState(batch, event.sensor_state);
+		break;
+	case SENSOR_UPDATE:
+		batch << std::endl << "## UPDATE SENSOR ";
+		printTXID(batch, event.vendor, event.txid) << " ##" << std::endl;
+		batch << "SEEN " << event.count << " TIMES, NOW " << asciiTime(event.time);
+		printStatusDiff(batch, event.former_state, event.sensor_state);
+		break;
+	case SENSOR_EVICT:
+		batch << std::endl << "## EVICT STALE SENSOR ";
+		printTXID(batch, event.vendor, event.txid) << " ##" << std::endl;
+		break;
+	case SUMMARY_BEGIN:
+		batch << std::endl << "## SENSOR SUMMARY ##" << std::endl;
+		if (!event.count) {
+			batch << "NO SENSORS FOUND" << std::endl;
+		}
+		break;
+	case SUMMARY_SENSOR:
+		batch << "TXID ";
+		printTXID(batch, event.vendor, event.txid) << " SEEN " << event.count << " TIMES" << std::endl;
+		if (event.data) {
+			batch << "(" << event.data << " EARLIER CHANGES NOT RETAINED)" << std::endl;
+		}
+		break;
+	case SUMMARY_CHANGE:
+		batch << "# " << asciiTime(event.time);
+		printStatusDiff(batch, event.former_state, event.sensor_state);
+		break;
+	case SUMMARY_SENSOR_END:
+		batch << std::endl;
+		break;
+	case CRC_FAIL:
+		batch << "CRC FAIL FOR DATA 0x" << std::hex << event.data << " AND RX CRC 0x" << (unsigned int)event.rx_crc
+				<< " WITH COMPUTED CRC 0x" << (unsigned int)event.calc_crc << std::dec << std::endl;
+		break;
+	case RAW_FRAME:
+		batch << "VIVINT SENSOR MESSAGE: 0x";
+		batch << std::setfill('0') << std::setw(event.count/4) << std::hex << event.data << std::dec << std::endl;
+		break;
+	case UNKNOWN_CHANNEL:
+		batch << std::endl;
+		batch << "No known vendor uses channel " << event.count << ", may cause CRC failure." << std::endl;
+		break;
+	case SENSOR_REPEATS:	// Reported in JSON and binary output only
+		break;
+	case STORE_FAILED:
+		batch << std::endl << "SENSOR STATE COULD NOT BE SAVED, NO LONGER PERSISTING IT (ERROR " << event.count << ")" << std::endl;
+		break;
+	}
+}
+
+
+void EventWriter::formatJSON(const OutputEvent& event) {
+	static const char* event_names[] = {"add", "update", "evict", "summary", "summary_sensor", "summary_change", "summary_sensor_end",
+			"crc_fail", "raw_frame", "unknown_channel", "repeats", "store_failed"};
+
+	batch << "{\"event\":\"" << event_names[event.type] << "\"";
+	switch (event.type) {
+	case SENSOR_ADD:
+	case SENSOR_UPDATE:
+	case SENSOR_EVICT:
+	case SUMMARY_SENSOR:
+	case SENSOR_REPEATS:
+		batch << ",\"txid\":" << event.txid << ",\"txid_str\":\"";
+		printTXID(batch, event.vendor, event.txid) << "\",\"vendor\":\"" << vendor_names[event.vendor] << "\"";
+		break;
+	default:
+		break;
+	}
+
+	switch (event.type) {
+	case SENSOR_ADD:
+		batch << ",\"device\":\"" << deviceName(event.devid) << "\"";
+		[[fallthrough]];
+	case SENSOR_UPDATE:
+		batch << ",\"count\":" << event.count << ",\"receiver\":" << (unsigned int)event.receiver << ",\"rssi\":" << std::round(event.rssi*10)/10;
+		if (!std::isnan(event.freq_offset)) {
+			batch << ",\"freq_offset\":" << std::lround(event.freq_offset);
+		}
+		[[fallthrough]];
+	case SUMMARY_CHANGE:
+		batch << ",\"time\":";
+		printTime(batch, event.time) << ",\"state\":" << (unsigned int)event.sensor_state;
+		if (event.type != SENSOR_ADD) {
+			batch << ",\"former_state\":" << (unsigned int)event.former_state;
+		}
+		batch << ",\"status\":{";
+		for (unsigned int i = 1; i <= SENSOR_STATE_BITS; i++) {
+			batch << (i > 1 ? "," : "") << "\"" << status_bit_states[i-1][2] << "\":\""
+					<< status_bit_states[i-1][event.sensor_state>>(SENSOR_STATE_BITS-i) & 0x1] << "\"";
+		}
+		batch << "}";
+		break;
+	case SUMMARY_BEGIN:
+		batch << ",\"sensors\":" << event.count;
+		break;
+	case SUMMARY_SENSOR:
+		batch << ",\"count\":" << event.count << ",\"not_retained\":" << event.data;
+		break;
+	case CRC_FAIL:
+		batch << ",\"data\":\"0x" << std::hex << event.data << std::dec << "\",\"bits\":" << event.count
+				<< ",\"rx_crc\":" << (unsigned int)event.rx_crc << ",\"calc_crc\":" << (unsigned int)event.calc_crc;
+		break;
+	case RAW_FRAME:
+		batch << ",\"vendor\":\"" << vendor_names[event.vendor] << "\",\"data\":\"0x" << std::hex << event.data << std::dec << "\",\"bits\":" << event.count;
+		break;
+	case UNKNOWN_CHANNEL:
+		batch << ",\"channel\":" << event.count;
+		break;
+	case SENSOR_REPEATS:
+		batch << ",\"time\":";
+		printTime(batch, event.time) << ",\"state\":" << (unsigned int)event.sensor_state
+				<< ",\"repeats\":" << event.repeat_count << ",\"manchester_errors\":" << event.manchester_errors
+				<< ",\"receiver\":" << (unsigned int)event.receiver << ",\"rssi\":" << std::round(event.rssi*10)/10;
+		if (!std::isnan(event.freq_offset)) {
+			batch << ",\"freq_offset\":" << std::lround(event.freq_offset);
+		}
+		break;
+	case STORE_FAILED:
+		batch << ",\"error\":" << event.count;
+		break;
+	default:
+		break;
+	}
+
+	batch << "}" << std::endl;
+}
+
+
+void EventWriter::formatBinary(const OutputEvent& event) {
+	BinaryRecord record {};
+	record.type = event.type;
+	record.vendor = event.vendor;
+	record.devid = event.devid;
+	record.former_state = event.former_state;
+	record.sensor_state = event.sensor_state;
+	record.rx_crc = event.rx_crc;
+	record.count = event.count;
+	record.calc_crc = event.calc_crc;
+	record.receiver = event.receiver;
+	record.rssi = std::lround(event.rssi*100);
+	record.txid = event.txid;
+	record.time = event.time;
+	record.data = event.data;
+	record.repeat_count = event.repeat_count;
+	record.manchester_errors = event.manchester_errors;
+
+	batch.write((const char*)&record, sizeof(record));
+}
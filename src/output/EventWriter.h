@@ -0,0 +1,78 @@
+#ifndef SRC_EVENTWRITER_H_
+#define SRC_EVENTWRITER_H_
+
+
+#include "OutputEvent.h"
+#include "../util/BoundedQueue.h"
+
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#define EVENT_QUEUE_SIZE 65536	// Events buffered between the decoder and the writer thread
+#define WRITER_IDLE_SLEEP 5	// Milliseconds the writer thread sleeps when there is nothing to write
+#define WRITER_FULL_WAIT 1	// Milliseconds emitBlocking() waits for the writer thread to make room
+#define BINARY_MAGIC "S345EV03"	// Leads binary output, followed by fixed-size BinaryRecords
+
+
+enum OutputFormat {TEXT, JSON, BINARY};
+
+
+/*
+ * Fixed layout of an event in the binary output format, native (little-endian) byte order
+ */
+struct BinaryRecord {
+	uint8_t type;
+	uint8_t vendor;
+	uint8_t devid;
+	uint8_t former_state;
+	uint8_t sensor_state;
+	uint8_t receiver;
+	uint16_t rx_crc;
+	uint32_t count;
+	uint16_t calc_crc;
+	int16_t rssi;	// Hundredths of a dBFS
+	uint64_t txid;
+	int64_t time;	// Nanoseconds since the Unix epoch
+	uint64_t data;
+	uint32_t repeat_count;
+	uint32_t manchester_errors;
+};
+static_assert(sizeof(BinaryRecord) == 48, "BinaryRecord layout must not contain padding");
+
+
+/*
+ * Queues events from the decode path and formats and writes them in batches on a separate thread,
+ * so the decoder never waits on the output stream. Events are dropped (and counted) if the queue
+ * fills up because the output cannot keep up. Summaries emitted with emitBlocking() wait for room
+ * instead, they are produced in bursts far faster than they can be written.
+ */
+class EventWriter : public EventSink {
+public:
+	EventWriter(const OutputFormat& format = TEXT, std::ostream& output = std::cout);
+	~EventWriter();	// Writes all queued events before returning
+	void emit(const OutputEvent& event) override;
+	void emitBlocking(const OutputEvent& event) override;
+	unsigned long long int getDropCount() const {return dropped.load(std::memory_order_relaxed);};
+private:
+	void run();
+	bool drain();
+	void formatText(const OutputEvent& event);
+	void formatJSON(const OutputEvent& event);
+	void formatBinary(const OutputEvent& event);
+	const OutputFormat format;
+	std::ostream& output;
+	BoundedQueue<OutputEvent> queue;
+	std::atomic<bool> running {true};
+	std::atomic<unsigned long long int> dropped {0};
+	std::ostringstream batch;	// Formatted output of the events drained in one pass
+	std::thread writer_thread;
+};
+
+
+std::ostream& printTXID(std::ostream& out, const Vendor& vendor, const unsigned long int& txid);
+const char* vendorName(const Vendor& vendor);
+
+
+#endif /* SRC_EVENTWRITER_H_ */
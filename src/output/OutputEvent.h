@@ -0,0 +1,63 @@
+#ifndef SRC_OUTPUTEVENT_H_
+#define SRC_OUTPUTEVENT_H_
+
+
+#include "../messaging/FrameLayout.h"
+
+#include <ctime>
+
+#define NS_PER_SEC 1000000000LL
+
+
+enum EventType : unsigned char {
+	SENSOR_ADD,	// New sensor: txid, vendor, devid, sensor_state, time, receiver, rssi (of the first copy of the frame)
+	SENSOR_UPDATE,	// Sensor seen again: txid, vendor, count, former_state, sensor_state, time, receiver, rssi (of the first copy of the frame)
+	SENSOR_EVICT,	// Stale sensor removed from tracking: txid, vendor, followed by its summary
+	SUMMARY_BEGIN,	// Start of the sensor summary: count (number of sensors)
+	SUMMARY_SENSOR,	// Start of one sensor's history: txid, vendor, count, data (changes not retained)
+	SUMMARY_CHANGE,	// One state change in a sensor's history: former_state, sensor_state, time
+	SUMMARY_SENSOR_END,	// End of one sensor's history
+	CRC_FAIL,	// Frame failed CRC check: data, count (data bits), rx_crc, calc_crc
+	RAW_FRAME,	// Raw frame dump for vendors that are not fully understood: vendor, data, count (data bits)
+	UNKNOWN_CHANNEL,	// Frame on a channel with no known vendor: count (channel)
+	SENSOR_REPEATS,	// Copies of a reported frame, once no more arrived for the dedup window: txid, vendor, sensor_state, time (last copy), repeat_count, manchester_errors, receiver, rssi, freq_offset (strongest copy)
+	STORE_FAILED	// Sensor state could not be persisted, tracking carries on in memory only: count (StoreError)
+};
+
+
+/*
+ * Fixed-size record of something worth reporting. Producers fill these on the decode path
+ * without any formatting, all text, time conversion and I/O happens in the writer.
+ */
+struct OutputEvent {
+	EventType type;
+	Vendor vendor;
+	unsigned char devid;
+	unsigned char former_state;
+	unsigned char sensor_state;
+	unsigned int count;
+	unsigned long int txid;
+	long long int time;	// Nanoseconds since the Unix epoch, from the sample clock for message events
+	unsigned long long int data;
+	char16_t rx_crc;
+	char16_t calc_crc;
+	unsigned char receiver;	// Radio that decoded the message
+	float rssi;	// dBFS
+	float freq_offset;	// Hz from the nominal carrier, NAN when not measured
+	unsigned int repeat_count;	// Copies of the frame received, from all radios
+	unsigned int manchester_errors;	// Skipped Manchester sequences of the best copy, fewer is better
+};
+
+
+/*
+ * Destination for output events
+ */
+class EventSink {
+public:
+	virtual ~EventSink() {};
+	virtual void emit(const OutputEvent& event) = 0;	// May drop the event rather than wait
+	virtual void emitBlocking(const OutputEvent& event) {emit(event);};	// Never drops the event, for summaries that are produced off the decode path
+};
+
+
+#endif /* SRC_OUTPUTEVENT_H_ */
@@ -0,0 +1,127 @@
+#include "StatsReporter.h"
+#include "EventWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+
+static const char* stage_names[] = {"IF FILTER", "BB DC FILTER", "BB LP FILTER", "RECEIVER"};
+
+
+StatsReporter::StatsReporter(const TrackerStats& tracker_stats, std::ostream& output)
+	: tracker_stats(tracker_stats), output(output), last_report(std::chrono::steady_clock::now()) {}
+
+
+void StatsReporter::addPipeline(const unsigned int& index, const DecodePipeline& pipeline, const RadioStats* radio_stats,
+		const GainController* gain_controller) {
+	pipelines.push_back(PipelineEntry {index, &pipeline, radio_stats, gain_controller});
+}
+
+
+void StatsReporter::tick() {
+	if (std::chrono::steady_clock::now() - last_report >= std::chrono::seconds(STATS_PERIOD)) {
+		report();
+	}
+}
+
+
+void StatsReporter::report() {
+	auto now = std::chrono::steady_clock::now();
+	double period = std::chrono::duration<double>(now - last_report).count();
+	last_report = now;
+
+	output << std::fixed << std::setprecision(1) << std::setfill(' ');
+	for (auto& entry : pipelines) {
+		const auto& stats = entry.pipeline->getStats();
+		output << std::endl << "## STATS RADIO " << entry.index << " (" << period << " s) ##" << std::endl;
+		output << std::left << std::setw(16) << "STAGE" << std::right << std::setw(14) << "IN/S" << std::setw(14) << "OUT/S" << std::setw(14) << "NS/SAMPLE" << std::endl;
+		for (unsigned int stage = 0; stage < NUM_STAGES; stage++) {
+			auto samples_in = stats.samples_in[stage].get();
+			auto samples_out = stats.samples_out[stage].get();
+			auto timed_samples = stats.timed_samples[stage].get();
+			auto timed_ns = stats.timed_ns[stage].get();
+
+			output << std::left << std::setw(16) << stage_names[stage] << std::right
+					<< std::setw(14) << (samples_in - entry.last_in[stage])/period
+					<< std::setw(14) << (samples_out - entry.last_out[stage])/period
+					<< std::setw(14) << ((timed_samples > entry.last_timed_samples[stage]) ?
+							1.0*(timed_ns - entry.last_timed_ns[stage])/(timed_samples - entry.last_timed_samples[stage]) : 0) << std::endl;
+
+			entry.last_in[stage] = samples_in;
+			entry.last_out[stage] = samples_out;
+			entry.last_timed_samples[stage] = timed_samples;
+			entry.last_timed_ns[stage] = timed_ns;
+		}
+
+		const auto& receiver_stats = entry.pipeline->getReceiverStats();
+		output << "FRAMES SYNCED " << receiver_stats.synced.get() << ", REJECTED " << receiver_stats.rejected.get()
+				<< ", MANCHESTER ERRORS " << receiver_stats.manchester_errors.get() << std::endl;
+		for (unsigned int vendor = 0; vendor < NUM_VENDORS; vendor++) {
+			if (receiver_stats.crc_pass[vendor].get() | receiver_stats.crc_fail[vendor].get()) {
+				output << vendorName((Vendor)vendor) << " CRC PASS " << receiver_stats.crc_pass[vendor].get()
+						<< ", CRC FAIL " << receiver_stats.crc_fail[vendor].get() << std::endl;
+			}
+		}
+
+		if (entry.radio_stats) {
+			output << "STREAM BLOCKS " << entry.radio_stats->blocks.get() << ", OVERFLOWS " << entry.radio_stats->overflows.get()
+					<< ", TIMEOUTS " << entry.radio_stats->timeouts.get() << ", ERRORS " << entry.radio_stats->errors.get() << std::endl;
+		}
+
+		if (entry.gain_controller) {
+			output << "GAIN " << entry.gain_controller->getGain() << " dB, RAISED " << entry.gain_controller->getRaised()
+					<< ", LOWERED " << entry.gain_controller->getLowered() << std::endl;
+		}
+		if (entry.pipeline->getMonitor()) {
+			reportSpectrum(*entry.pipeline->getMonitor(), entry.last_spectrum);
+		}
+	}
+
+	auto messages = tracker_stats.messages.get();
+	auto tracker_ns = tracker_stats.ns.get();
+	output << std::endl << "## STATS TRACKER (" << period << " s) ##" << std::endl;
+	output << "MESSAGES/S " << (messages - last_messages)/period << ", NS/MESSAGE "
+			<< ((messages > last_messages) ? 1.0*(tracker_ns - last_tracker_ns)/(messages - last_messages) : 0) << std::endl;
+	if (frame_bus) {
+		output << "FRAME BUS DROPPED " << frame_bus->getDropped() << ", DECODERS BLOCKED " << frame_bus->getBlocked() << ", MEAN BATCH "
+				<< (frame_bus->getBatches() ? 1.0*frame_bus->getFrames()/frame_bus->getBatches() : 0) << std::endl;
+	}
+	output << std::defaultfloat;
+
+	last_messages = messages;
+	last_tracker_ns = tracker_ns;
+}
+
+
+/*
+ * Noise floor, occupancy and clipping over the last period, and the mean spectrum across the IF band
+ */
+void StatsReporter::reportSpectrum(SpectrumMonitor& monitor, SpectrumStats& last_spectrum) {
+	auto totals = monitor.totals();
+	auto spectrum = totals - last_spectrum;
+	last_spectrum = totals;
+	auto decibels = [](const double& power) {return 10*std::log10(std::max(power, 1e-30));};
+
+	output << "SPECTRUM BLOCKS " << spectrum.blocks << ", SKIPPED " << monitor.getSkipped() << ", NOISE FLOOR ";
+	if (spectrum.blocks > spectrum.occupied) {
+		output << decibels(spectrum.noise_floor/(spectrum.blocks - spectrum.occupied)) << " dBFS/BIN";
+	} else {
+		output << "UNKNOWN";
+	}
+	output << ", OCCUPIED " << (spectrum.blocks ? 100.0*spectrum.occupied/spectrum.blocks : 0) << "%"
+			<< ", CLIPPED " << (spectrum.raw_samples ? 100.0*spectrum.clipped/spectrum.raw_samples : 0) << "%" << std::endl;
+
+	if (spectrum.blocks) {
+		output << "SPECTRUM dBFS/BIN FROM " << -monitor.getIFRate()/2e3 << " TO " << monitor.getIFRate()/2e3 << " kHz";
+		const unsigned int band_bins = SPECTRUM_FFT_SIZE/SPECTRUM_REPORT_BANDS;
+		for (unsigned int band = 0; band < SPECTRUM_REPORT_BANDS; band++) {
+			double power = 0;
+			for (unsigned int bin = band*band_bins; bin < (band+1)*band_bins; bin++) {
+				power += spectrum.power[bin];
+			}
+			output << " " << decibels(power/band_bins/spectrum.blocks);
+		}
+		output << std::endl;
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef SRC_STATSREPORTER_H_
+#define SRC_STATSREPORTER_H_
+
+
+#include "../dsp/DecodePipeline.h"
+#include "../dsp/GainController.h"
+#include "../messaging/FrameBus.h"
+#include "../util/StatCounter.h"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#define STATS_PERIOD 10	// Seconds between stats reports
+
+
+/*
+ * Sample stream counters of one radio, written by its receive thread
+ */
+struct alignas(CACHE_LINE_SIZE) RadioStats {
+	StatCounter blocks;
+	StatCounter overflows;
+	StatCounter timeouts;
+	StatCounter errors;	// Any other readStream error
+};
+
+
+/*
+ * Tracker counters, written by the tracker thread
+ */
+struct alignas(CACHE_LINE_SIZE) TrackerStats {
+	StatCounter messages;	// Messages passed to the tracker, before deduplication
+	StatCounter ns;	// Time spent deduplicating and tracking them
+};
+
+
+/*
+ * Periodically reports the counters of each pipeline and the tracker, as rates over the last period
+ * for sample counts and as totals for frame counts. Spectrum statistics of pipelines with a monitor
+ * are over the last period. Runs on the tracker thread, reading counters
+ * written by other threads without synchronizing with them.
+ */
+class StatsReporter {
+public:
+	StatsReporter(const TrackerStats& tracker_stats, std::ostream& output = std::cerr);
+	void addPipeline(const unsigned int& index, const DecodePipeline& pipeline, const RadioStats* radio_stats = nullptr,
+			const GainController* gain_controller = nullptr);	// Radio stats are optional, file input has none
+	void addFrameBus(const FrameBus& frame_bus) {this->frame_bus = &frame_bus;};
+	void tick();	// Reports if STATS_PERIOD has passed since the last report
+	void report();
+private:
+	void reportSpectrum(SpectrumMonitor& monitor, SpectrumStats& last_spectrum);
+	struct PipelineEntry {
+		unsigned int index;
+		const DecodePipeline* pipeline;
+		const RadioStats* radio_stats;
+		const GainController* gain_controller;
+		std::array<unsigned long long int, NUM_STAGES> last_in {};	// Counter values at the last report
+		std::array<unsigned long long int, NUM_STAGES> last_out {};
+		std::array<unsigned long long int, NUM_STAGES> last_timed_samples {};
+		std::array<unsigned long long int, NUM_STAGES> last_timed_ns {};
+		SpectrumStats last_spectrum {};
+	};
+	const TrackerStats& tracker_stats;
+	std::ostream& output;
+	std::vector<PipelineEntry> pipelines;
+	std::chrono::steady_clock::time_point last_report;
+	unsigned long long int last_messages {0};
+	unsigned long long int last_tracker_ns {0};
+	const FrameBus* frame_bus {nullptr};
+};
+
+
+#endif /* SRC_STATSREPORTER_H_ */
@@ -0,0 +1,237 @@
+#include "QueryServer.h"
+#include "../output/EventWriter.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+struct QueryClient {
+	int fd;
+	std::string request;	// Request lines received and not yet answered, the last may be partial
+	std::string response;	// Response being sent, the next request is answered once it is all sent
+	size_t sent {0};	// Bytes of the response sent so far
+};
+
+
+/*
+ * Parses a TXID in decimal, 0x hex, or the printed 007-4565 / 3562-090-0847 (Vivint) forms, returns 0 if invalid
+ */
+static unsigned long int parseTXID(const std::string& text) {
+	std::vector<unsigned long int> fields;
+	std::istringstream field_stream(text);
+	std::string field;
+	while (std::getline(field_stream, field, '-')) {
+		bool hex = (field.size() > 2) && !field.compare(0, 2, "0x") && (text.find('-') == std::string::npos);
+		char* end;
+		fields.push_back(std::strtoul(field.c_str() + (hex ? 2 : 0), &end, hex ? 16 : 10));
+		if (field.empty() || *end) {
+			return 0;
+		}
+	}
+
+	switch (fields.size()) {
+	case 1:
+		return fields[0];
+	case 2:
+		return fields[0]*10000 + fields[1];
+	case 3:
+		return (fields[0]<<STD_TXID_BITS) | (fields[1]*10000 + fields[2]);
+	default:
+		return 0;
+	}
+}
+
+
+static void printSensor(std::ostream& out, const SensorSnapshot& sensor) {
+	out << "{\"txid\":" << sensor.txid << ",\"txid_str\":\"";
+	printTXID(out, sensor.vendor, sensor.txid) << "\",\"vendor\":\"" << vendorName(sensor.vendor) << "\",\"state\":" << (unsigned int)sensor.sensor_state
+			<< ",\"count\":" << sensor.rx_msg_count << ",\"last_seen\":" << sensor.last_seen << "}";
+}
+
+
+QueryServer::QueryServer(const std::string& socket_path, SnapshotPublisher<TrackerSnapshot>& snapshot_publisher)
+	: socket_path(socket_path), snapshot_publisher(snapshot_publisher) {
+
+	sockaddr_un address {};
+	address.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(address.sun_path)) {
+		throw SOCKET_BIND_FAILED;
+	}
+	std::strcpy(address.sun_path, socket_path.c_str());
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0) {
+		throw SOCKET_CREATE_FAILED;
+	}
+
+	unlink(socket_path.c_str());	// Remove a socket left behind by a previous run
+	if (bind(listen_fd, (sockaddr*)&address, sizeof(address)) || listen(listen_fd, QUERY_MAX_CLIENTS)) {
+		close(listen_fd);
+		throw SOCKET_BIND_FAILED;
+	}
+
+	server_thread = std::thread(&QueryServer::run, this);
+}
+
+
+QueryServer::~QueryServer() {
+	running.store(false);
+	server_thread.join();
+
+	close(listen_fd);
+	unlink(socket_path.c_str());
+}
+
+
+void QueryServer::run() {
+	std::vector<QueryClient> clients;
+	std::vector<pollfd> poll_fds;
+
+	while (running.load()) {
+		poll_fds.clear();
+		poll_fds.push_back(pollfd {listen_fd, POLLIN, 0});
+		for (const auto& client : clients) {	// A client still receiving a response is not read from meanwhile
+			poll_fds.push_back(pollfd {client.fd, (short)(client.response.empty() ? POLLIN : POLLOUT), 0});
+		}
+
+		if (poll(poll_fds.data(), poll_fds.size(), QUERY_POLL_TIMEOUT) <= 0) {
+			continue;
+		}
+
+		// Serve requests from connected clients
+		for (size_t i = clients.size(); i > 0; i--) {
+			auto& client = clients[i-1];
+			if (!poll_fds[i].revents) {
+				continue;
+			}
+
+			bool disconnect = false;
+			if (client.response.empty()) {
+				char buffer[QUERY_MAX_LINE];
+				auto received = recv(client.fd, buffer, sizeof(buffer), 0);
+				disconnect = (received == 0) || ((received < 0) && (errno != EAGAIN) && (errno != EINTR));
+				if (received > 0) {
+					client.request.append(buffer, received);
+				}
+			}
+
+			if (disconnect || !serve(client)) {
+				close(client.fd);
+				clients.erase(clients.begin()+(i-1));
+			}
+		}
+
+		// Accept new clients
+		if (poll_fds[0].revents & POLLIN) {
+			int client_fd;
+			while ((client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+				if (clients.size() < QUERY_MAX_CLIENTS) {
+					clients.push_back(QueryClient {client_fd});
+				} else {
+					close(client_fd);
+				}
+			}
+		}
+	}
+
+	for (const auto& client : clients) {
+		close(client.fd);
+	}
+}
+
+
+/*
+ * Sends as much of the pending response as the socket takes without blocking, and answers the
+ * client's next request whenever a response has been sent in full. A slow reader only holds up
+ * itself, returns false if the client should be disconnected.
+ */
+bool QueryServer::serve(QueryClient& client) {
+	while (true) {
+		while (client.sent < client.response.size()) {
+			auto sent = send(client.fd, client.response.data() + client.sent, client.response.size() - client.sent, MSG_NOSIGNAL);
+			if (sent < 0) {
+				return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);	// Continued on POLLOUT
+			}
+			client.sent += sent;
+		}
+		client.response.clear();
+		client.sent = 0;
+
+		auto line_end = client.request.find('\n');
+		if (line_end == std::string::npos) {
+			return client.request.size() <= QUERY_MAX_LINE;
+		}
+
+		auto request = client.request.substr(0, line_end);
+		client.request.erase(0, line_end+1);
+		client.response = respond(request, snapshot_publisher.acquire()) + "\n";
+		snapshot_publisher.release();
+	}
+}
+
+
+/*
+ * Builds a TXID lookup for a newly published snapshot, on the server thread
+ */
+void QueryServer::refreshIndex(const TrackerSnapshot* snapshot) {
+	if (snapshot->generation == indexed_generation) {
+		return;
+	}
+
+	txid_index.clear();
+	txid_index.reserve(snapshot->sensors.size());
+	for (size_t i = 0; i < snapshot->sensors.size(); i++) {
+		txid_index[snapshot->sensors[i].txid] = i;
+	}
+	indexed_generation = snapshot->generation;
+}
+
+
+std::string QueryServer::respond(const std::string& request, const TrackerSnapshot* snapshot) {
+	std::istringstream request_stream(request);
+	std::string command, argument;
+	request_stream >> command >> argument;
+
+	std::ostringstream response;
+	if (!snapshot) {
+		response << "{\"error\":\"no tracker state published yet\"}";
+	} else if (command == "STATE") {
+		refreshIndex(snapshot);
+		auto sensor = txid_index.find(parseTXID(argument));
+		if (sensor != txid_index.end()) {
+			printSensor(response, snapshot->sensors[sensor->second]);
+		} else {
+			response << "{\"error\":\"unknown txid\"}";
+		}
+	} else if (command == "RECENT") {
+		size_t num_changes = argument.empty() ? snapshot->recent.size() : std::min<size_t>(std::strtoul(argument.c_str(), nullptr, 10), snapshot->recent.size());
+		response << "{\"recent\":[";
+		for (auto change = snapshot->recent.end()-num_changes; change != snapshot->recent.end(); ++change) {
+			response << ((change != snapshot->recent.end()-num_changes) ? "," : "") << "{\"txid\":" << change->txid << ",\"txid_str\":\"";
+			printTXID(response, change->vendor, change->txid) << "\",\"time\":" << change->time
+					<< ",\"former_state\":" << (unsigned int)change->former_state << ",\"state\":" << (unsigned int)change->sensor_state << "}";
+		}
+		response << "]}";
+	} else if (command == "COUNTERS") {
+		response << "{\"time\":" << snapshot->time << ",\"sensors\":" << snapshot->sensors.size()
+				<< ",\"messages\":" << snapshot->counters.messages << ",\"added\":" << snapshot->counters.added
+				<< ",\"changes\":" << snapshot->counters.changes << ",\"evicted\":" << snapshot->counters.evicted << "}";
+	} else if (command == "LIST") {
+		response << "{\"sensors\":[";
+		for (size_t i = 0; i < snapshot->sensors.size(); i++) {
+			response << (i ? "," : "");
+			printSensor(response, snapshot->sensors[i]);
+		}
+		response << "]}";
+	} else {
+		response << "{\"error\":\"unknown command, expected STATE <TXID>, RECENT [N], COUNTERS or LIST\"}";
+	}
+
+	return response.str();
+}
@@ -0,0 +1,54 @@
+#ifndef SRC_QUERYSERVER_H_
+#define SRC_QUERYSERVER_H_
+
+
+#include "../tracking/TrackerSnapshot.h"
+#include "../util/SnapshotPublisher.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define QUERY_MAX_CLIENTS 64
+#define QUERY_POLL_TIMEOUT 200	// Milliseconds between checks for shutdown
+#define QUERY_MAX_LINE 256	// Longest accepted request line
+
+
+enum QueryError {SOCKET_CREATE_FAILED, SOCKET_BIND_FAILED};
+
+struct QueryClient;
+
+
+/*
+ * Serves queries of the tracker state over a local Unix-domain socket, one request per line and
+ * one JSON response per line. Requests are answered from the latest snapshot published by the
+ * tracker, so serving clients never contends with the decode thread. Client sockets are non-blocking
+ * and responses are sent as each client reads them, so a slow client never holds up the others.
+ *
+ * STATE <TXID>	Current state of a sensor, TXID in decimal, 0x hex, or printed (007-4565) form
+ * RECENT [N]	The N (default all retained) most recent state changes
+ * COUNTERS	Tracker counters
+ * LIST		All tracked sensors
+ */
+class QueryServer {
+public:
+	QueryServer(const std::string& socket_path, SnapshotPublisher<TrackerSnapshot>& snapshot_publisher);
+	~QueryServer();
+private:
+	void run();
+	bool serve(QueryClient& client);
+	void refreshIndex(const TrackerSnapshot* snapshot);
+	std::string respond(const std::string& request, const TrackerSnapshot* snapshot);
+	const std::string socket_path;
+	SnapshotPublisher<TrackerSnapshot>& snapshot_publisher;
+	int listen_fd {-1};
+	std::atomic<bool> running {true};
+	unsigned long long int indexed_generation {0};	// Snapshot generation txid_index was built for
+	std::unordered_map<unsigned long int, size_t> txid_index;	// TXID to position in the indexed snapshot
+	std::thread server_thread;
+};
+
+
+#endif /* SRC_QUERYSERVER_H_ */
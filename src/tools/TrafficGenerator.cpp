@@ -0,0 +1,323 @@
+#include "../dsp/FrameSynthesizer.h"
+#include "../output/EventWriter.h"
+#include "../tracking/FrameDeduplicator.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#define GEN_SIGNAL_AMPLITUDE 0.5	// Of each transmission, leaves headroom for overlapping transmissions in CS8 output
+#define GEN_LEAD_IN 0.5	// Seconds of noise before the first transmission, lets the decoder's filters settle
+#define GEN_FREQ_STEP 10	// Hz, carrier offsets are rounded to this so the carrier tables stay small
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+using std::strcmp;
+
+
+enum IQFormat {CF32, CS8};
+
+
+/*
+ * One event of a synthetic sensor, sent as several repeats of the same frame
+ */
+struct Transmission {
+	size_t start;	// Sample
+	SyntheticFrame frame;
+	double symbol_rate_scale;
+	int freq_offset;
+};
+
+
+void printHelp(char* command) {
+	cerr << "Usage:" << endl << command << " [OPTIONS] OUTPUT FILE" << endl;
+	cerr << command << " --score EXPECTED FILE DECODED FILE" << endl << endl;
+	cerr << "Synthesizes 345 MHz sensor traffic as IQ samples at " << SAMP_RATE << " samples/s, tuned as Soapy345 tunes the radio, and writes the events "
+			"the decoder is expected to report. With --score, compares the expected events with Soapy345 --format json output and reports the decode yield." << endl << endl;
+	cerr << "OPTIONS:" << endl;
+	cerr << "--format cf32|cs8: Sample format, complex float (default) or complex signed 8-bit." << endl;
+	cerr << "--expected FILE: Write the expected add and update events to FILE as JSON lines." << endl;
+	cerr << "--sensors N: Distinct sensors transmitting, default 10." << endl;
+	cerr << "--events N: State changes sent by each sensor, default 4." << endl;
+	cerr << "--rate N: Mean events per second over all sensors, transmissions overlap at high rates. Default 2." << endl;
+	cerr << "--repeats N: Copies of each frame per event, default 3." << endl;
+	cerr << "--vendors LIST: Comma separated mix of honeywell, 2gig and vivint. Default honeywell,2gig." << endl;
+	cerr << "--snr DB: Signal to noise ratio in the " << SENSOR_BW << " Hz sensor bandwidth, default 20." << endl;
+	cerr << "--jitter PERCENT: Maximum symbol rate error of each transmission, default 0." << endl;
+	cerr << "--freq-offset HZ: Carrier offset from " << SIG_FREQ << " Hz, default 0. With --freq-spread, the centre of the offsets." << endl;
+	cerr << "--freq-spread HZ: Maximum random offset of each sensor's carrier from --freq-offset, default 0." << endl;
+	cerr << "--seed N: Random seed, default 1." << endl;
+}
+
+
+/*
+ * Parses a comma separated list of vendor names, returns false if it is invalid
+ */
+bool parseVendorList(const char* list, std::vector<Vendor>& vendors) {
+	std::istringstream list_stream(list);
+	std::string name;
+	while (std::getline(list_stream, name, ',')) {
+		if (name == "honeywell") {
+			vendors.push_back(HONEYWELL);
+		} else if (name == "2gig") {
+			vendors.push_back(TWOGIG);
+		} else if (name == "vivint") {
+			vendors.push_back(VIVINT_INIT);	// Regular Vivint frames are not CRC verified, so are never reported
+		} else {
+			return false;
+		}
+	}
+
+	return !vendors.empty();
+}
+
+
+/*
+ * Reads the (txid, state) of each add and update event from JSON lines, in order
+ */
+std::vector<std::pair<unsigned long int, unsigned int>> readEvents(std::istream& in) {
+	std::vector<std::pair<unsigned long int, unsigned int>> events;
+	std::string line;
+	while (std::getline(in, line)) {
+		if ((line.find("\"event\":\"add\"") == std::string::npos) && (line.find("\"event\":\"update\"") == std::string::npos)) {
+			continue;
+		}
+
+		auto txid = line.find("\"txid\":");
+		auto state = line.find("\"state\":");
+		if ((txid == std::string::npos) || (state == std::string::npos)) {
+			continue;
+		}
+		events.emplace_back(std::stoul(line.substr(txid+7)), std::stoul(line.substr(state+8)));
+	}
+
+	return events;
+}
+
+
+int score(const char* expected_path, const char* decoded_path) {
+	std::ifstream expected_file(expected_path);
+	std::ifstream decoded_file(decoded_path);
+	if (!expected_file || !decoded_file) {
+		cerr << "\"" << (expected_file ? decoded_path : expected_path) << "\"" << " is not a valid input file." << endl;
+		return EXIT_FAILURE;
+	}
+
+	// Events are matched by sensor and state, in order, since the decoder's times depend on when it was run
+	std::multiset<std::pair<unsigned long int, unsigned int>> expected;
+	auto expected_events = readEvents(expected_file);
+	expected.insert(expected_events.begin(), expected_events.end());
+
+	unsigned long int decoded = 0, spurious = 0;
+	for (const auto& event : readEvents(decoded_file)) {
+		auto match = expected.find(event);
+		if (match != expected.end()) {
+			expected.erase(match);
+			decoded++;
+		} else {
+			spurious++;
+		}
+	}
+
+	cout << "Expected " << expected_events.size() << " events, decoded " << decoded << ", missed " << expected.size() << ", spurious " << spurious << endl;
+	cout << "Yield " << (expected_events.empty() ? 0 : 100.0*decoded/expected_events.size()) << "%" << endl;
+
+	return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char* argv[]) {
+	char* output_path = nullptr;
+	char* expected_path = nullptr;
+	IQFormat format = CF32;
+	unsigned long int num_sensors = 10;
+	unsigned long int events_per_sensor = 4;
+	double event_rate = 2;
+	unsigned long int repeats = 3;
+	std::vector<Vendor> vendors;
+	float snr = 20;
+	double jitter = 0;
+	double freq_offset = 0;
+	double freq_spread = 0;
+	unsigned long int seed = 1;
+	try {
+		for (signed int i = 1; i<argc; i++) {
+			if (!strcmp(argv[i], "-h") | !strcmp(argv[i], "--help")) {
+				printHelp(argv[0]);
+
+				return EXIT_SUCCESS;
+			} else if (!strcmp(argv[i], "--score") & (i+2 < argc)) {
+				return score(argv[i+1], argv[i+2]);
+			} else if (!strcmp(argv[i], "--format") & (i+1 < argc)) {
+				i++;
+				if (!strcmp(argv[i], "cf32")) {
+					format = CF32;
+				} else if (!strcmp(argv[i], "cs8")) {
+					format = CS8;
+				} else {
+					cerr << "\"" << argv[i] << "\"" << " is not a valid sample format." << endl << endl;
+					printHelp(argv[0]);
+
+					return EXIT_FAILURE;
+				}
+			} else if (!strcmp(argv[i], "--expected") & (i+1 < argc)) {
+				expected_path = argv[++i];
+			} else if (!strcmp(argv[i], "--sensors") & (i+1 < argc)) {
+				num_sensors = std::stoul(argv[++i]);
+			} else if (!strcmp(argv[i], "--events") & (i+1 < argc)) {
+				events_per_sensor = std::stoul(argv[++i]);
+			} else if (!strcmp(argv[i], "--rate") & (i+1 < argc)) {
+				event_rate = std::stod(argv[++i]);
+			} else if (!strcmp(argv[i], "--repeats") & (i+1 < argc)) {
+				repeats = std::stoul(argv[++i]);
+			} else if (!strcmp(argv[i], "--vendors") & (i+1 < argc)) {
+				i++;
+				if (!parseVendorList(argv[i], vendors)) {
+					cerr << "\"" << argv[i] << "\"" << " is not a valid vendor list." << endl << endl;
+					printHelp(argv[0]);
+
+					return EXIT_FAILURE;
+				}
+			} else if (!strcmp(argv[i], "--snr") & (i+1 < argc)) {
+				snr = std::stof(argv[++i]);
+			} else if (!strcmp(argv[i], "--jitter") & (i+1 < argc)) {
+				jitter = std::stod(argv[++i])/100;
+			} else if (!strcmp(argv[i], "--freq-offset") & (i+1 < argc)) {
+				freq_offset = std::stod(argv[++i]);
+			} else if (!strcmp(argv[i], "--freq-spread") & (i+1 < argc)) {
+				freq_spread = std::stod(argv[++i]);
+			} else if (!strcmp(argv[i], "--seed") & (i+1 < argc)) {
+				seed = std::stoul(argv[++i]);
+			} else if ((argv[i][0] != '-') & !output_path) {
+				output_path = argv[i];
+			} else {
+				cerr << "\"" << argv[i] << "\"" << " is not a valid option." << endl << endl;
+				printHelp(argv[0]);
+
+				return EXIT_FAILURE;
+			}
+		}
+	} catch (std::logic_error&) {	// Thrown by std::stoul and friends on a malformed number
+		cerr << "Option values must be numbers." << endl << endl;
+		printHelp(argv[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	if (!output_path || !num_sensors || !events_per_sensor || !repeats || (event_rate <= 0) || (jitter < 0) || (jitter >= 1)) {
+		printHelp(argv[0]);
+
+		return EXIT_FAILURE;
+	}
+	if (vendors.empty()) {
+		vendors = {HONEYWELL, TWOGIG};
+	}
+	if (std::abs(freq_offset) + freq_spread + std::abs(TUNE_FREQ_OFFSET) + SENSOR_BW/2 > SAMP_RATE/2) {
+		cerr << "Carrier offsets must keep the signal within the " << SAMP_RATE << " samples/s band." << endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream output_file(output_path, std::ios::out | std::ios::binary);
+	if (!output_file) {
+		cerr << "\"" << output_path << "\"" << " could not be opened." << endl;
+		return EXIT_FAILURE;
+	}
+
+
+
+
+	/* --------------------------------------------
+	 * -------------SCHEDULE TRAFFIC---------------
+	   --------------------------------------------*/
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> unit(-1, 1);
+
+	// Each sensor has its own carrier offset, and takes turns with the others through the vendor mix
+	std::vector<SyntheticFrame> sensors;
+	std::vector<int> sensor_offsets;
+	for (unsigned long int i = 0; i < num_sensors; i++) {
+		SyntheticFrame sensor {vendors[i%vendors.size()], 0x10000ul + i*7919, 0x00, 0xABC, 0x18};
+		sensor.txid |= (sensor.vendor == VIVINT_INIT) ? ((0x100ul + i)<<STD_TXID_BITS) : 0;
+		sensors.push_back(sensor);
+		sensor_offsets.push_back(std::lround((freq_offset + unit(rng)*freq_spread)/GEN_FREQ_STEP)*GEN_FREQ_STEP);
+	}
+
+	// Event times are uniform over the run, so their mean rate is event_rate, and sensors alternate their state at every event.
+	// A sensor's own events are spaced beyond the dedup window, or the decoder would rightly collapse a return to an earlier state.
+	const size_t lead_in = GEN_LEAD_IN*SAMP_RATE;
+	const double duration = num_sensors*events_per_sensor/event_rate;
+	std::uniform_real_distribution<double> start_time(0, duration);
+	std::vector<Transmission> transmissions;
+	for (unsigned long int i = 0; i < num_sensors; i++) {
+		std::vector<size_t> starts;
+		for (unsigned long int j = 0; j < events_per_sensor; j++) {
+			starts.push_back(lead_in + start_time(rng)*SAMP_RATE);
+		}
+		std::sort(starts.begin(), starts.end());
+		const size_t burst_len = repeats*(FrameSynthesizer::encode(sensors[i]).size()*PULSE_WIDTH*SAMP_RATE/(1-jitter) + SYNTH_REPEAT_GAP);
+		for (size_t j = 1; j < starts.size(); j++) {
+			starts[j] = std::max(starts[j], starts[j-1] + burst_len + (size_t)(DEDUP_WINDOW*SAMP_RATE));
+		}
+
+		for (auto start : starts) {
+			sensors[i].sensor_state ^= 0x80;	// Loop 1
+			transmissions.push_back({start, sensors[i], 1 + unit(rng)*jitter, sensor_offsets[i]});
+		}
+	}
+	std::sort(transmissions.begin(), transmissions.end(), [](const Transmission& a, const Transmission& b) {return a.start < b.start;});
+
+
+
+
+	/* --------------------------------------------
+	 * ------------SYNTHESIZE AND WRITE------------
+	   --------------------------------------------*/
+
+	FrameSynthesizer synthesizer(FrameSynthesizer::noiseAmplitude(GEN_SIGNAL_AMPLITUDE, snr), GEN_SIGNAL_AMPLITUDE, seed);
+	synthesizer.addSilence(lead_in);
+	for (const auto& transmission : transmissions) {
+		synthesizer.addFrame(transmission.frame, transmission.start, repeats, transmission.symbol_rate_scale, transmission.freq_offset);
+	}
+	const auto& signal = synthesizer.render();
+
+	if (format == CF32) {
+		output_file.write((const char*)signal.data(), signal.size()*sizeof(signal[0]));
+	} else {
+		std::vector<int8_t> samples;
+		samples.reserve(signal.size()*2);
+		for (const auto& sample : signal) {
+			samples.push_back(std::clamp(std::lround(sample.real()*127), -127l, 127l));
+			samples.push_back(std::clamp(std::lround(sample.imag()*127), -127l, 127l));
+		}
+		output_file.write((const char*)samples.data(), samples.size());
+	}
+
+	// Expected events follow the decoder's JSON output, with times relative to the start of the file
+	if (expected_path) {
+		std::ofstream expected_file(expected_path);
+		std::set<unsigned long int> added;
+		for (const auto& transmission : transmissions) {
+			const auto& frame = transmission.frame;
+			expected_file << "{\"event\":\"" << (added.insert(frame.txid).second ? "add" : "update") << "\",\"txid\":" << frame.txid << ",\"txid_str\":\"";
+			printTXID(expected_file, frame.vendor, frame.txid) << "\",\"vendor\":\"" << vendorName(frame.vendor) << "\",\"time\":"
+					<< (double)transmission.start/SAMP_RATE << ",\"state\":" << (unsigned int)frame.sensor_state
+					<< ",\"freq_offset\":" << transmission.freq_offset << ",\"symbol_rate_scale\":" << transmission.symbol_rate_scale << "}" << endl;
+		}
+	}
+
+	cerr << "Wrote " << transmissions.size() << " events from " << num_sensors << " sensors, " << (double)signal.size()/SAMP_RATE << " seconds of "
+			<< ((format == CF32) ? "CF32" : "CS8") << " samples" << endl;
+
+	return EXIT_SUCCESS;
+}
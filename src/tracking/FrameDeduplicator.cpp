@@ -0,0 +1,111 @@
+#include "FrameDeduplicator.h"
+
+#include <algorithm>
+
+
+FrameDeduplicator::FrameDeduplicator(EventSink* event_sink, const double& window)
+	: event_sink(event_sink), window(window*NS_PER_SEC) {}
+
+
+/*
+ * Returns the message if it starts a new event, or nullptr if it repeats an event already passed downstream
+ */
+std::shared_ptr<SensorMessage> FrameDeduplicator::push(std::shared_ptr<SensorMessage> sensor_message) {
+	if (!sensor_message) {	// Verify that message exists
+		return sensor_message;
+	}
+
+	auto now = sensor_message->getTime();	// Copies from several radios may arrive slightly out of order
+	CacheEntry* replace = &cache.front();
+	for (auto& entry : cache) {
+		if (entry.open && (now - entry.last_seen <= window)) {
+			if ((entry.txid == sensor_message->getTXID()) & (entry.sensor_state == sensor_message->getState())) {
+				// Repeat of an event in progress, collapse it into the event
+				entry.repeat_count++;
+				entry.manchester_errors = std::min(entry.manchester_errors, sensor_message->getManchesterErrors());	// Keep the best signal quality seen
+				if (sensor_message->getRSSI() > entry.rssi) {	// Copies may come from several radios, report the strongest
+					entry.rssi = sensor_message->getRSSI();
+					entry.receiver = sensor_message->getReceiver();
+					entry.freq_offset = sensor_message->getFreqOffset();
+				}
+				entry.last_seen = std::max(entry.last_seen, now);
+
+				return std::shared_ptr<SensorMessage>(nullptr);
+			}
+		} else if (entry.open) {	// Expired entry
+			close(entry);
+		}
+
+		// Prefer an unused entry, otherwise replace the least recently seen event
+		if (replace->open && (!entry.open || (entry.last_seen < replace->last_seen))) {
+			replace = &entry;
+		}
+	}
+
+	// New event
+	if (replace->open) {
+		close(*replace);
+	}
+	replace->open = true;
+	replace->txid = sensor_message->getTXID();
+	replace->sensor_state = sensor_message->getState();
+	replace->vendor = sensor_message->getVendor();
+	replace->last_seen = now;
+	replace->repeat_count = 1;
+	replace->manchester_errors = sensor_message->getManchesterErrors();
+	replace->receiver = sensor_message->getReceiver();
+	replace->rssi = sensor_message->getRSSI();
+	replace->freq_offset = sensor_message->getFreqOffset();
+
+	return sensor_message;
+}
+
+
+void FrameDeduplicator::expire(const long long int& now) {
+	for (auto& entry : cache) {
+		if (entry.open && (now - entry.last_seen > window)) {
+			close(entry);
+		}
+	}
+}
+
+
+/*
+ * Closes events in the order they were last seen
+ */
+void FrameDeduplicator::flush() {
+	std::array<CacheEntry*, DEDUP_CACHE_SIZE> entries;
+	for (unsigned int i = 0; i < DEDUP_CACHE_SIZE; i++) {
+		entries[i] = &cache[i];
+	}
+	std::sort(entries.begin(), entries.end(), [](const CacheEntry* a, const CacheEntry* b) {return a->last_seen < b->last_seen;});
+
+	for (auto entry : entries) {
+		if (entry->open) {
+			close(*entry);
+		}
+	}
+}
+
+
+/*
+ * Reports the copies collapsed into an event and frees its entry
+ */
+void FrameDeduplicator::close(CacheEntry& entry) {
+	entry.open = false;
+	if (!event_sink) {
+		return;
+	}
+
+	OutputEvent event {SENSOR_REPEATS};
+	event.vendor = entry.vendor;
+	event.txid = entry.txid;
+	event.sensor_state = entry.sensor_state;
+	event.time = entry.last_seen;
+	event.repeat_count = entry.repeat_count;
+	event.manchester_errors = entry.manchester_errors;
+	event.receiver = entry.receiver;
+	event.rssi = entry.rssi;
+	event.freq_offset = entry.freq_offset;
+	event_sink->emit(event);
+}
@@ -0,0 +1,48 @@
+#ifndef SRC_FRAMEDEDUPLICATOR_H_
+#define SRC_FRAMEDEDUPLICATOR_H_
+
+
+#include "../messaging/SensorMessageReceiver.h"
+#include "../output/OutputEvent.h"
+
+#include <array>
+#include <memory>
+
+#define DEDUP_WINDOW 2.0	// Seconds of silence after which a repeated frame is treated as a new event, by the sample clock
+#define DEDUP_CACHE_SIZE 32	// Number of concurrent events tracked, oldest is replaced when full
+
+
+/*
+ * Sensors transmit each event as a burst of repeated frames. Collapses the repeats into a single
+ * event, keyed on (TXID, state), so downstream tracking runs once per event instead of once per frame.
+ * With several radios, the copies each radio decodes are collapsed the same way. The first copy is
+ * passed on at once, and the number of copies, their best quality and the radio that heard the
+ * strongest copy are reported as a SENSOR_REPEATS event when the event's window closes.
+ */
+class FrameDeduplicator {
+public:
+	FrameDeduplicator(EventSink* event_sink = nullptr, const double& window = DEDUP_WINDOW);
+	std::shared_ptr<SensorMessage> push(std::shared_ptr<SensorMessage> sensor_message);
+	void expire(const long long int& now);	// Closes events last seen more than a window before now, ns since the Unix epoch
+	void flush();	// Closes all events, once no more frames will be pushed
+private:
+	struct CacheEntry {
+		bool open {false};
+		unsigned long int txid {};
+		unsigned char sensor_state {};
+		Vendor vendor {};
+		long long int last_seen {};	// Message time, ns
+		unsigned int repeat_count {};	// Copies received, from all radios
+		unsigned int manchester_errors {};	// Fewest of any copy
+		unsigned char receiver {};	// Radio of the strongest copy
+		float rssi {};	// Of the strongest copy
+		float freq_offset {};	// Of the strongest copy
+	};
+	void close(CacheEntry& entry);
+	EventSink* const event_sink;	// Repeats are not reported when there is no sink
+	const long long int window;	// ns
+	std::array<CacheEntry, DEDUP_CACHE_SIZE> cache;
+};
+
+
+#endif /* SRC_FRAMEDEDUPLICATOR_H_ */
@@ -0,0 +1,40 @@
+#include "HistoryArena.h"
+
+
+time_t HistoryChunk::lastTime() const {
+	time_t entry_time = base_time;
+	for (unsigned int i = 1; i < count; i++) {
+		entry_time += deltas[i];
+	}
+
+	return entry_time;
+}
+
+
+/*
+ * Returns the index of an empty chunk, reusing released chunks before growing the arena
+ */
+unsigned int HistoryArena::allocate(const time_t& base_time) {
+	unsigned int chunk;
+	if (free_list != NO_CHUNK) {
+		chunk = free_list;
+		free_list = chunks[chunk].next;
+		free_count--;
+	} else {
+		chunk = chunks.size();
+		chunks.emplace_back();
+	}
+
+	chunks[chunk].base_time = base_time;
+	chunks[chunk].next = NO_CHUNK;
+	chunks[chunk].count = 0;
+
+	return chunk;
+}
+
+
+void HistoryArena::release(const unsigned int& chunk) {
+	chunks[chunk].next = free_list;
+	free_list = chunk;
+	free_count++;
+}
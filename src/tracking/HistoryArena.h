@@ -0,0 +1,63 @@
+#ifndef SRC_HISTORYARENA_H_
+#define SRC_HISTORYARENA_H_
+
+
+#include <ctime>
+#include <vector>
+
+#define HISTORY_CHUNK_ENTRIES 16	// State changes per chunk
+#define HISTORY_RETENTION_CHUNKS 8	// Default number of chunks kept per sensor, oldest are dropped first
+#define HISTORY_MAX_DELTA 0xFFFF	// Largest time delta (seconds) an entry can encode, larger gaps start a new chunk
+#define NO_CHUNK 0xFFFFFFFF
+
+
+/*
+ * Fixed-size block of sensor state history, stored as columns of 1-byte states and
+ * 2-byte timestamp deltas
+ */
+struct HistoryChunk {
+	time_t base_time;	// Time of the first entry
+	unsigned int next;	// Index of the next (newer) chunk of the same sensor
+	unsigned char count;
+	unsigned char states[HISTORY_CHUNK_ENTRIES];
+	unsigned short deltas[HISTORY_CHUNK_ENTRIES];	// Seconds since the previous entry, first entry is always 0
+	time_t lastTime() const;
+};
+
+
+/*
+ * Pool of history chunks shared by all sensors, so history memory is allocated in large
+ * blocks and reused as sensors drop old entries or are evicted
+ */
+class HistoryArena {
+public:
+	HistoryArena(const unsigned int& retention_chunks = HISTORY_RETENTION_CHUNKS) : retention_chunks(retention_chunks ? retention_chunks : 1) {};
+	unsigned int allocate(const time_t& base_time);
+	void release(const unsigned int& chunk);
+	HistoryChunk& operator[](const unsigned int& chunk) {return chunks[chunk];};
+	const HistoryChunk& operator[](const unsigned int& chunk) const {return chunks[chunk];};
+	size_t size() const {return chunks.size()-free_count;};	// Chunks in use
+	size_t bytes() const {return chunks.capacity()*sizeof(HistoryChunk);};
+	template <typename FUNC>
+	void forEachEntry(const unsigned int& head, FUNC func) const;	// Calls func(sensor_state, time) for each entry of the chunks from head on
+	const unsigned int retention_chunks;	// Bound on chunks kept per sensor
+private:
+	std::vector<HistoryChunk> chunks;
+	unsigned int free_list {NO_CHUNK};	// Released chunks, linked through HistoryChunk::next
+	size_t free_count {0};
+};
+
+
+template <typename FUNC>
+void HistoryArena::forEachEntry(const unsigned int& head, FUNC func) const {
+	for (auto chunk = head; chunk != NO_CHUNK; chunk = chunks[chunk].next) {
+		time_t entry_time = chunks[chunk].base_time;
+		for (unsigned int i = 0; i < chunks[chunk].count; i++) {
+			entry_time += chunks[chunk].deltas[i];
+			func(chunks[chunk].states[i], entry_time);
+		}
+	}
+}
+
+
+#endif /* SRC_HISTORYARENA_H_ */
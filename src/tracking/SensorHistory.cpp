@@ -1,81 +1,94 @@
 #include "SensorHistory.h"
 
-#include <iostream>
-#include <ctime>
 
-
-SensorHistory::SensorHistory(const Vendor& vendor, const unsigned char& sensor_state): vendor(vendor) {
-	history.push_back(std::pair<unsigned char, time_t>(sensor_state, time(NULL)));
-
-	// Output initial sensor state to the console
-	std::cout << "SEEN " << rx_msg_count << " TIMES, NOW " << std::asctime(std::localtime(&history.back().second));
-	unsigned int i = 1;
-	for (auto bit_state : status_bit_states) {
-		std::cout << bit_state[2] << ": "; // Output bit descriptor
-		// Output state description
-		std::cout << bit_state[sensor_state>>(SENSOR_STATE_BITS-i) & 0x1] << std::endl;
-
-		i++;	// Next bit
-	}
+SensorHistory::SensorHistory(HistoryArena& arena, const Vendor& vendor, const unsigned char& sensor_state, const time_t& time): vendor(vendor), arena(arena) {
+	last_seen = time;
+	addEntry(sensor_state, time);
 }
 
 
-SensorHistory::SensorHistory(SensorHistory&& obj): vendor(obj.vendor), history(obj.history), rx_msg_count(obj.rx_msg_count) {
-	obj.history.clear();
+SensorHistory::SensorHistory(SensorHistory&& obj): vendor(obj.vendor), arena(obj.arena), head(obj.head), tail(obj.tail), num_chunks(obj.num_chunks),
+		dropped_entries(obj.dropped_entries), cur_state(obj.cur_state), rx_msg_count(obj.rx_msg_count), confirmed(obj.confirmed), last_seen(obj.last_seen) {
+	obj.head = NO_CHUNK;	// Chunks are now owned by this object
+	obj.tail = NO_CHUNK;
+	obj.num_chunks = 0;
 	obj.rx_msg_count = 0;
 }
 
 
 SensorHistory::~SensorHistory() {
-	if (rx_msg_count) {
-		std::cout << "SEEN " << rx_msg_count << " TIMES" << std::endl;
-		for (auto entry = ++history.begin(); entry != history.end(); ++entry) {	// Print status diff starting with the second entry
-			// Print timestamp for this entry
-			std::cout << "# " << std::asctime(std::localtime(&entry->second));
-
-			// Print status changes for entry
-			printStatusDiff(entry);
-		}
-
-		std::cout << std::endl;
+	// Return history chunks to the arena
+	while (head != NO_CHUNK) {
+		auto next = arena[head].next;
+		arena.release(head);
+		head = next;
 	}
 }
 
 
-void SensorHistory::updateSensorState(const unsigned char& sensor_state) {
+void SensorHistory::updateSensorState(const unsigned char& sensor_state, const time_t& time) {
 	// Update counter and time for messages received from this sensor
-	auto curTime = time(NULL);
+	last_seen = time;
 	rx_msg_count++;
-	std::cout << "SEEN " << rx_msg_count << " TIMES, NOW " << std::asctime(std::localtime(&curTime));
 
 	// Skip updating sensor state if it has not changed
-	if (history.back().first == sensor_state) {
+	if (cur_state == sensor_state) {
 		return;
 	}
 
 	// Add sensor status update to the history
-	history.push_back(std::pair<unsigned char, time_t>(sensor_state, curTime));
+	addEntry(sensor_state, time);
+}
 
-	// Output changes to sensor state to the console
-	printStatusDiff(--history.end());
+
+/*
+ * Restores the counters of a sensor rebuilt from persisted history
+ */
+void SensorHistory::restore(const unsigned int& rx_msg_count, const time_t& last_seen, const unsigned int& dropped_entries, const bool& confirmed) {
+	this->rx_msg_count = rx_msg_count;
+	this->confirmed = confirmed;
+	this->last_seen = last_seen;
+	this->dropped_entries += dropped_entries;	// Entries may also have been dropped while restoring under a smaller retention bound
 }
 
 
 /*
- * Given an iterator, prints a summary of differences between the current and previous states
+ * Appends a state change to the newest chunk, starting a new chunk when it is full or the time
+ * delta does not fit, and dropping the oldest chunk when the retention bound is exceeded
  */
-void SensorHistory::printStatusDiff(const std::vector<std::pair<unsigned char, time_t>>::iterator& entry) const {
-	unsigned int i = 1;
-	for (auto bit_state : status_bit_states) {
-		bool former_bit = ((entry-1)->first>>(SENSOR_STATE_BITS-i)) & 0x1;
-		bool cur_bit = (entry->first>>(SENSOR_STATE_BITS-i)) & 0x1;
-		if (former_bit != cur_bit) {
-			std::cout << bit_state[2] << ": ";	// Output bit descriptor
-			// Output change description
-			std::cout	<< bit_state[former_bit] << "->"
-						<< bit_state[cur_bit] << std::endl;
+void SensorHistory::addEntry(const unsigned char& sensor_state, const time_t& entry_time) {
+	cur_state = sensor_state;
+
+	if (tail != NO_CHUNK) {
+		auto& chunk = arena[tail];
+		auto delta = entry_time - chunk.lastTime();
+		if ((chunk.count < HISTORY_CHUNK_ENTRIES) & (delta >= 0) & (delta <= HISTORY_MAX_DELTA)) {
+			chunk.states[chunk.count] = sensor_state;
+			chunk.deltas[chunk.count] = delta;
+			chunk.count++;
+			return;
 		}
+	}
+
+	// Start a new chunk, the arena may reallocate so chunk references are not held across this call
+	auto chunk = arena.allocate(entry_time);
+	arena[chunk].states[0] = sensor_state;
+	arena[chunk].deltas[0] = 0;
+	arena[chunk].count = 1;
 
-		i++;	// Next bit
+	if (tail != NO_CHUNK) {
+		arena[tail].next = chunk;
+	} else {
+		head = chunk;
+	}
+	tail = chunk;
+	num_chunks++;
+
+	if (num_chunks > arena.retention_chunks) {	// Drop the oldest chunk
+		auto next = arena[head].next;
+		dropped_entries += arena[head].count;
+		arena.release(head);
+		head = next;
+		num_chunks--;
 	}
 }
@@ -3,35 +3,62 @@
 
 
 #include "../messaging/SensorMessageReceiver.h"
+#include "HistoryArena.h"
 
-#include <string>
-#include <vector>
-
-
-static const std::string status_bit_states[SENSOR_STATE_BITS][3] = {
-		{"CLOSED", "OPEN", "LOOP ONE"},	// False state, True state, Name
-		{"NORM", "TRIP", "TAMPER"},
-		{"CLOSED", "OPEN", "LOOP TWO"},
-		{"FALSE", "TRUE", "UNKb4"},
-		{"NORM", "LOW", "BATTERY"},
-		{"EVENT", "PERIODIC", "TRIGGER"},
-		{"FALSE", "TRUE", "PAIR"},
-		{"FALSE", "TRUE", "UNKb0"}
-};
 
 
 class SensorHistory {
 public:
-	SensorHistory(const Vendor& vendor, const unsigned char& sensor_state);
+	SensorHistory(HistoryArena& arena, const Vendor& vendor, const unsigned char& sensor_state, const time_t& time);
 	SensorHistory(SensorHistory&& obj);
 	~SensorHistory();
-	void updateSensorState(const unsigned char& sensor_state);
+	void updateSensorState(const unsigned char& sensor_state, const time_t& time);
+	unsigned char getState() const {return cur_state;};
+	unsigned int getMessageCount() const {return rx_msg_count;};
+	void confirm() {confirmed = true;};	// A repeat of its message was received
+	bool isConfirmed() const {return confirmed || (rx_msg_count > 1);};	// By a repeat or a second message, rather than noise passing the CRC
+	time_t getLastSeen() const {return last_seen;};
+	unsigned int getDroppedEntries() const {return dropped_entries;};
+	unsigned int getFirstChunk() const {return head;};	// For reading the history from a copy of the arena
+	void restore(const unsigned int& rx_msg_count, const time_t& last_seen, const unsigned int& dropped_entries, const bool& confirmed);
+	template <typename FUNC>
+	void forEachEntry(FUNC func) const;	// Calls func(sensor_state, time) for each retained history entry, oldest first
+	template <typename FUNC>
+	void forEachChange(FUNC func) const;	// Calls func(former_state, sensor_state, time) for each retained state change
 	const Vendor vendor;
 private:
-	void printStatusDiff(const std::vector<std::pair<unsigned char, time_t>>::iterator& entry) const;
-	std::vector<std::pair<unsigned char, time_t>> history;
+	void addEntry(const unsigned char& sensor_state, const time_t& entry_time);
+	HistoryArena& arena;
+	unsigned int head {NO_CHUNK};	// Oldest retained chunk
+	unsigned int tail {NO_CHUNK};	// Newest chunk
+	unsigned int num_chunks {0};
+	unsigned int dropped_entries {0};	// State changes dropped by the retention bound
+	unsigned char cur_state;
 	unsigned int rx_msg_count {1};
+	bool confirmed {false};
+	time_t last_seen;
 };
 
 
+template <typename FUNC>
+void SensorHistory::forEachEntry(FUNC func) const {
+	arena.forEachEntry(head, func);
+}
+
+
+template <typename FUNC>
+void SensorHistory::forEachChange(FUNC func) const {
+	bool first_entry = true;	// The oldest retained entry is the baseline for the following changes
+	unsigned char former_state = 0;
+	forEachEntry([&](const unsigned char& sensor_state, const time_t& entry_time) {
+		if (!first_entry) {
+			func(former_state, sensor_state, entry_time);
+		}
+
+		first_entry = false;
+		former_state = sensor_state;
+	});
+}
+
+
 #endif /* SRC_SENSORHISTORY_H_ */
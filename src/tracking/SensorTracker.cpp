@@ -1,51 +1,44 @@
 #include "SensorTracker.h"
 
-#include <iostream>
-#include <iomanip>
+#include <algorithm>
 
 
-void printTXID(const Vendor& vendor, const unsigned long int& txid) {
-	if ((vendor == VIVINT_INIT) | (vendor == VIVINT)) {
-		std::cout << std::setfill('0') << std::setw(4) << (txid>>STD_TXID_BITS) << "-";	// Print extra Vivint-specific leading TXID field
+SensorTracker::SensorTracker(EventSink* event_sink, StateStore* state_store, const size_t& expected_sensors, const unsigned int& history_retention) :
+		event_sink(event_sink), state_store(state_store), history_arena(history_retention), sensors(expected_sensors) {
+	if (state_store) {	// Warm restart from persisted state
+		load();
 	}
+}
+
 
-	// Strip extra Vivint TXID field and print remaining fields as normal
-	std::cout << std::setfill('0') << std::setw(3) << ((txid & STD_TXID_MASK)/10000);
-	std::cout << "-" << std::setw(4) << ((txid & STD_TXID_MASK)%10000);
+SensorTracker::~SensorTracker() {
+	finish();
 }
 
 
-void printDevice(const unsigned char& devid) {
-	switch (devid) {
-	case 0x18:
-		std::cout << "DW11";
-		break;
-	case 0x0f:
-		std::cout << "DW21R";
-		break;
-	case 0x14:
-		std::cout << "GB2";
-		break;
-	case 0x0a:
-		std::cout << "PIR2";
-		break;
-	default:
-		std::cout << "UNKNOWN";
+/*
+ * Report summary of sensor activity, runs once even if it throws
+ */
+void SensorTracker::finish() {
+	if (finished) {
+		return;
 	}
-}
+	finished = true;
 
+	persist([&]() {	// Wait for any snapshot being written, then write the final one
+		state_store->collectSnapshot(true);
+		compact();
+		state_store->collectSnapshot(true);
+	});
 
-SensorTracker::~SensorTracker() {	// Print summary of sensor activity
-	std::cout << std::endl;
-	std::cout << "## SENSOR SUMMARY ##" << std::endl;
-	if (sensors.empty()) {
-		std::cout << "NO SENSORS FOUND" << std::endl;
-	} else {
-		for (auto sensor = sensors.begin(); sensor != sensors.end(); sensors.erase(sensor++)) {	// Erase each sensor to trigger its destructor and print history summary
-			std::cout << "TXID ";
-			printTXID(sensor->second.vendor, sensor->first);
-			std::cout << " ";
-		}
+	OutputEvent summary {SUMMARY_BEGIN};
+	summary.count = sensors.size();
+	emitBlocking(summary);
+
+	auto txids = sensors.keys();
+	std::sort(txids.begin(), txids.end());
+	for (const auto& txid : txids) {
+		emitSummary(txid, *sensors.find(txid));
 	}
 }
 
@@ -55,24 +48,293 @@ void SensorTracker::push(std::shared_ptr<SensorMessage> sensor_message) {
 		return;
 	}
 
+	time_t now = sensor_message->getTime() / NS_PER_SEC;	// History is kept at one second resolution
+	OutputEvent event {};
+	event.vendor = sensor_message->getVendor();
+	event.txid = sensor_message->getTXID();
+	event.sensor_state = sensor_message->getState();
+	event.time = sensor_message->getTime();
+	event.receiver = sensor_message->getReceiver();
+	event.rssi = sensor_message->getRSSI();
+	event.freq_offset = sensor_message->getFreqOffset();
+
 	auto sensor = sensors.find(sensor_message->getTXID());
-	if (sensor != sensors.end()) {	// Sensor detected previously, update it
-		// Output debug info to console
-		std::cout << std::endl << "## UPDATE SENSOR ";
-		printTXID(sensor_message->getVendor(), sensor_message->getTXID());
-		std::cout << " ##" << std::endl;
-
-		// Update sensor state
-		sensor->second.updateSensorState(sensor_message->getState());
+	if (sensor) {	// Sensor detected previously, update it
+		event.type = SENSOR_UPDATE;
+		event.former_state = sensor->getState();
 	} else {
-		// Output debug info to console
-		std::cout << std::endl << "## ADD ";
-		printDevice(sensor_message->getDEVID());
-		std::cout << " SENSOR ";
-		printTXID(sensor_message->getVendor(), sensor_message->getTXID());
-		std::cout << " ##" << std::endl;
+		event.type = SENSOR_ADD;
+		event.devid = sensor_message->getDEVID();
+	}
+
+	sensor = track(sensor_message->getTXID(), sensor_message->getVendor(), sensor_message->getState(), now);
+	if (latency) {
+		latency->record(sensor_message->getLatencyStamps(), latencyClock());
+	}
+	event.count = sensor->getMessageCount();
+	emit(event);
+
+	// Keep counters and recent changes for queries
+	counters.messages++;
+	if (event.type == SENSOR_ADD) {
+		counters.added++;
+	} else if (event.former_state != event.sensor_state) {
+		counters.changes++;
+		recent.push_back(StateChange {event.txid, now, event.vendor, event.former_state, event.sensor_state});
+		if (recent.size() > RECENT_CHANGES) {
+			recent.pop_front();
+		}
+	}
+	snapshot_stale = true;
+
+	persist([&]() {
+		state_store->append(LogRecord {sensor_message->getTXID(), now, (uint8_t)sensor_message->getVendor(), sensor_message->getState()});
+		if (state_store->needsCompaction()) {
+			compact();
+		}
+	});
+
+	if (now - last_eviction >= EVICTION_PERIOD) {
+		evict(now);
+	}
+
+	tick(now);
+}
+
+
+/*
+ * A repeat that passed its CRC shows the sensor is real, even if it never sends another event
+ */
+void SensorTracker::confirm(const unsigned long int& txid) {
+	auto sensor = sensors.find(txid);
+	if (!sensor || sensor->isConfirmed()) {
+		return;
+	}
+
+	sensor->confirm();
+	persist([&]() {
+		LogRecord record {txid, sensor->getLastSeen(), (uint8_t)sensor->vendor, sensor->getState()};
+		record.repeat = true;
+		state_store->append(record);
+	});
+}
+
+
+void SensorTracker::tick(const time_t& now) {
+	persist([&]() {	// Rebase the log once a snapshot is written, and write any snapshot held back meanwhile
+		if (state_store->collectSnapshot(false) && compaction_due) {
+			compact();
+		}
+	});
+
+	if (snapshot_publisher && snapshot_stale && (now - last_publish >= SNAPSHOT_PERIOD)) {
+		publish(now);
+	}
+}
+
+
+/*
+ * Adds a sensor or updates its state, shared by live messages and log replay
+ */
+SensorHistory* SensorTracker::track(const unsigned long int& txid, const Vendor& vendor, const unsigned char& sensor_state, const time_t& time) {
+	auto sensor = sensors.find(txid);
+	if (sensor) {	// Sensor detected previously, update it
+		sensor->updateSensorState(sensor_state, time);
+	} else {	// Add new sensor, constructed in place in the index
+		sensor = &sensors.emplace(txid, history_arena, vendor, sensor_state, time);
+	}
+
+	return sensor;
+}
+
+
+/*
+ * Rebuilds the tracked sensors from the latest snapshot and the messages logged since
+ */
+void SensorTracker::load() {
+	state_store->loadSnapshot([&](const StoredSensor& stored, const StoredEntry* entries) {
+		if ((stored.vendor >= NUM_VENDORS) | !stored.txid | (sensors.find(stored.txid) != nullptr)) {
+			throw STORE_CORRUPT;
+		}
+
+		auto& sensor = sensors.emplace(stored.txid, history_arena, (Vendor)stored.vendor, entries[0].sensor_state, entries[0].time);
+		for (unsigned int i = 1; i < stored.num_entries; i++) {
+			sensor.updateSensorState(entries[i].sensor_state, entries[i].time);
+		}
+		sensor.restore(stored.rx_msg_count, stored.last_seen, stored.dropped_entries, stored.confirmed);
+	});
+
+	state_store->replayLog([&](const LogRecord& record) {
+		if ((record.vendor >= NUM_VENDORS) | !record.txid) {
+			throw STORE_CORRUPT;
+		}
 
-		// Add new sensor, using std::move for the history so we can have different ~SensorHistory() behavior
-		sensors.insert(std::pair<unsigned long int, SensorHistory>(sensor_message->getTXID(), std::move(SensorHistory(sensor_message->getVendor(), sensor_message->getState()))));
+		if (!record.repeat) {
+			track(record.txid, (Vendor)record.vendor, record.sensor_state, record.time);
+		} else if (auto sensor = sensors.find(record.txid)) {	// Not found if evicted since
+			sensor->confirm();
+		}
+	});
+}
+
+
+/*
+ * Writes a snapshot of all sensors so the log can start over. It is written in the background from a
+ * copy of the sensor counters and of the history arena, a flat array that is cheap to copy, while the
+ * sensors keep changing.
+ */
+void SensorTracker::compact() {
+	if (state_store->snapshotPending()) {	// Snapshot again once the current one is written
+		compaction_due = true;
+		return;
+	}
+	compaction_due = false;
+
+	struct SnapshotCopy {
+		SnapshotCopy(const HistoryArena& history_arena) : history_arena(history_arena) {};
+		const HistoryArena history_arena;
+		std::vector<StoredSensor> sensors;	// num_entries is filled in when written
+		std::vector<unsigned int> first_chunks;
+	};
+	auto copy = std::make_shared<SnapshotCopy>(history_arena);
+	copy->sensors.reserve(sensors.size());
+	copy->first_chunks.reserve(sensors.size());
+	sensors.forEach([&](const unsigned long int& txid, SensorHistory& sensor) {
+		copy->sensors.push_back(StoredSensor {txid, sensor.getLastSeen(), sensor.getMessageCount(), sensor.getDroppedEntries(), 0, (uint8_t)sensor.vendor,
+				sensor.isConfirmed()});
+		copy->first_chunks.push_back(sensor.getFirstChunk());
+	});
+
+	state_store->startSnapshot(copy->sensors.size(), [copy](StateStore& store) {
+		std::vector<StoredEntry> entries;
+		for (size_t i = 0; i < copy->sensors.size(); i++) {
+			entries.clear();
+			copy->history_arena.forEachEntry(copy->first_chunks[i], [&](const unsigned char& sensor_state, const time_t& time) {
+				entries.push_back(StoredEntry {time, sensor_state});
+			});
+
+			copy->sensors[i].num_entries = entries.size();
+			store.addSnapshotSensor(copy->sensors[i], entries.data());
+		}
+	});
+}
+
+
+/*
+ * Removes sensors that have gone silent, and TXIDs seen in one frame only that were most likely
+ * produced by noise passing the CRC, so the index stays bounded on long-running nodes
+ */
+void SensorTracker::evict(const time_t& now) {
+	last_eviction = now;
+
+	std::vector<unsigned long int> evicted;
+	sensors.forEach([&](const unsigned long int& txid, SensorHistory& sensor) {
+		if (!sensor.isConfirmed() && (now - sensor.getLastSeen() >= UNCONFIRMED_SENSOR_AGE)) {
+			evicted.push_back(txid);	// Never confirmed, drop it silently
+		} else if (now - sensor.getLastSeen() >= STALE_SENSOR_AGE) {
+			OutputEvent event {SENSOR_EVICT};
+			event.vendor = sensor.vendor;
+			event.txid = txid;
+			event.time = now*NS_PER_SEC;
+			emitBlocking(event);
+			emitSummary(txid, sensor);
+			evicted.push_back(txid);
+		}
+	});
+
+	for (const auto& txid : evicted) {
+		sensors.erase(txid);
+	}
+	counters.evicted += evicted.size();
+	snapshot_stale |= !evicted.empty();
+
+	if (!evicted.empty()) {	// Don't let the log bring evicted sensors back on restart
+		persist([&]() {compact();});
+	}
+}
+
+
+/*
+ * Runs func on the state store. If the store fails, for example on a full disk, the failure is
+ * reported and tracking carries on in memory only.
+ */
+template <typename FUNC>
+void SensorTracker::persist(FUNC func) {
+	if (!state_store) {
+		return;
+	}
+
+	try {
+		func();
+	} catch (StoreError& e) {
+		state_store = nullptr;
+		OutputEvent event {STORE_FAILED};
+		event.count = e;
+		emitBlocking(event);
+	}
+}
+
+
+/*
+ * Reports the history of state changes of a sensor
+ */
+void SensorTracker::emitSummary(const unsigned long int& txid, const SensorHistory& sensor) {
+	if (!event_sink) {
+		return;
+	}
+
+	OutputEvent event {SUMMARY_SENSOR};
+	event.vendor = sensor.vendor;
+	event.txid = txid;
+	event.count = sensor.getMessageCount();
+	event.data = sensor.getDroppedEntries();
+	emitBlocking(event);
+
+	sensor.forEachChange([&](const unsigned char& former_state, const unsigned char& sensor_state, const time_t& time) {
+		OutputEvent change {SUMMARY_CHANGE};
+		change.vendor = sensor.vendor;
+		change.txid = txid;
+		change.former_state = former_state;
+		change.sensor_state = sensor_state;
+		change.time = time*NS_PER_SEC;
+		emitBlocking(change);
+	});
+
+	emitBlocking(OutputEvent {SUMMARY_SENSOR_END});
+}
+
+
+void SensorTracker::publishSnapshots(SnapshotPublisher<TrackerSnapshot>* snapshot_publisher) {
+	this->snapshot_publisher = snapshot_publisher;
+	if (snapshot_publisher) {
+		publish(time(NULL));	// Make the current (possibly restored) state available right away
 	}
 }
+
+
+/*
+ * Copies the tracker state into a new immutable snapshot
+ */
+std::unique_ptr<TrackerSnapshot> SensorTracker::snapshot(const time_t& now) {
+	auto snapshot = std::make_unique<TrackerSnapshot>();
+	snapshot->generation = ++snapshot_generation;
+	snapshot->time = now;
+	snapshot->sensors.reserve(sensors.size());
+	sensors.forEach([&](const unsigned long int& txid, SensorHistory& sensor) {
+		snapshot->sensors.push_back(SensorSnapshot {txid, sensor.getLastSeen(), sensor.getMessageCount(), sensor.vendor, sensor.getState()});
+	});
+	snapshot->recent.assign(recent.begin(), recent.end());
+	snapshot->counters = counters;
+
+	return snapshot;
+}
+
+
+/*
+ * Hands a snapshot to readers, rate limited to SNAPSHOT_PERIOD by the callers
+ */
+void SensorTracker::publish(const time_t& now) {
+	snapshot_publisher->publish(snapshot(now));
+	snapshot_stale = false;
+	last_publish = now;
+}
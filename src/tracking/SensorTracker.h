@@ -3,16 +3,61 @@
 
 
 #include "SensorHistory.h"
+#include "TXIDIndex.h"
+#include "StateStore.h"
+#include "TrackerSnapshot.h"
+#include "../output/OutputEvent.h"
+#include "../util/SnapshotPublisher.h"
+#include "../util/LatencyHistogram.h"
 
-#include <map>
+#include <ctime>
+#include <deque>
+
+#define EXPECTED_SENSORS 1024	// Initial index capacity, the index grows as needed
+#define EVICTION_PERIOD 600	// Seconds between scans for sensors to evict
+#define STALE_SENSOR_AGE (30*24*3600)	// Sensors silent for this many seconds are evicted
+#define UNCONFIRMED_SENSOR_AGE (2*3600)	// Sensors seen in one frame only are treated as noise after this many seconds
 
 
 class SensorTracker {
 public:
-	~SensorTracker();
+	SensorTracker(EventSink* event_sink = nullptr, StateStore* state_store = nullptr,
+			const size_t& expected_sensors = EXPECTED_SENSORS, const unsigned int& history_retention = HISTORY_RETENTION_CHUNKS);
+	~SensorTracker();	// Calls finish() if it was not called
+	void finish();	// Saves the final state and reports the summary of all sensors, once no more messages will be pushed
 	void push(std::shared_ptr<SensorMessage> sensor_message);
+	void confirm(const unsigned long int& txid);	// For each repeat of a message that FrameDeduplicator collapsed
+	void evict(const time_t& now);
+	void compact();	// Starts a snapshot of all sensors, or one after the snapshot being written
+	void publishSnapshots(SnapshotPublisher<TrackerSnapshot>* snapshot_publisher);
+	void measureLatency(PipelineLatency* latency) {this->latency = latency;};
+	void tick(const time_t& now);	// Publishes changes left over from a burst once SNAPSHOT_PERIOD has passed
+	std::unique_ptr<TrackerSnapshot> snapshot(const time_t& now);	// Copy of the current state, as published
+	size_t size() const {return sensors.size();};
+	const TrackerCounters& getCounters() const {return counters;};
 private:
-	std::map<const unsigned long int, SensorHistory> sensors;
+	void publish(const time_t& now);
+	void load();
+	template <typename FUNC>
+	void persist(FUNC func);
+	SensorHistory* track(const unsigned long int& txid, const Vendor& vendor, const unsigned char& sensor_state, const time_t& time);
+	void emit(const OutputEvent& event) const {if (event_sink) event_sink->emit(event);};
+	void emitBlocking(const OutputEvent& event) const {if (event_sink) event_sink->emitBlocking(event);};	// Summaries, which must not be dropped
+	void emitSummary(const unsigned long int& txid, const SensorHistory& sensor);
+	EventSink* const event_sink;	// Reports are discarded when there is no sink
+	StateStore* state_store;	// State is not persisted when there is no store, or after the store failed
+	bool compaction_due {false};	// Sensors were evicted while a snapshot was being written
+	bool finished {false};
+	HistoryArena history_arena;	// Must outlive the sensors, which return their history to it on destruction
+	TXIDIndex<SensorHistory> sensors;
+	time_t last_eviction {time(NULL)};
+	TrackerCounters counters {};
+	std::deque<StateChange> recent;	// Most recent state changes, newest last
+	SnapshotPublisher<TrackerSnapshot>* snapshot_publisher {nullptr};	// Snapshots are not published when there is no publisher
+	bool snapshot_stale {false};	// State changed since the last published snapshot
+	time_t last_publish {0};
+	unsigned long long int snapshot_generation {0};
+	PipelineLatency* latency {nullptr};	// Latency is not measured when there are no histograms
 };
 
 
@@ -0,0 +1,208 @@
+#include "StateStore.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+StateStore::StateStore(const std::string& directory)
+	: log_path(directory + "/" + STORE_LOG_FILE), snapshot_path(directory + "/" + STORE_SNAPSHOT_FILE) {
+
+	log_fd = open(log_path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (log_fd < 0) {
+		throw STORE_OPEN_FAILED;
+	}
+
+	struct stat log_stat;
+	if (fstat(log_fd, &log_stat)) {
+		close(log_fd);
+		throw STORE_OPEN_FAILED;
+	}
+
+	if ((size_t)log_stat.st_size < sizeof(StoreHeader)) {	// New log, initialize the header
+		mapLog(STORE_LOG_GROWTH);
+		log_header->magic = STORE_LOG_MAGIC;
+		log_header->generation = 0;
+		log_header->count = 0;
+	} else {
+		mapLog((log_stat.st_size - sizeof(StoreHeader)) / sizeof(LogRecord));
+		if ((log_header->magic != STORE_LOG_MAGIC) | (log_header->count > log_capacity)) {
+			munmap(log_header, sizeof(StoreHeader) + log_capacity*sizeof(LogRecord));
+			close(log_fd);
+			throw STORE_CORRUPT;
+		}
+	}
+}
+
+
+StateStore::~StateStore() {
+	if (snapshot_thread.joinable()) {	// Uncollected snapshot, the log is rebased on it when next opened
+		snapshot_thread.join();
+	}
+
+	if (log_header) {	// Unmapped if growing the log failed
+		msync(log_header, sizeof(StoreHeader) + log_capacity*sizeof(LogRecord), MS_SYNC);
+		munmap(log_header, sizeof(StoreHeader) + log_capacity*sizeof(LogRecord));
+	}
+	close(log_fd);
+}
+
+
+/*
+ * Maps a whole file for reading, returns nullptr if it does not exist
+ */
+const void* StateStore::mapReadOnly(const std::string& path, size_t& size) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		if (errno == ENOENT) {
+			return nullptr;
+		}
+		throw STORE_OPEN_FAILED;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat)) {
+		close(fd);
+		throw STORE_OPEN_FAILED;
+	}
+
+	size = file_stat.st_size;
+	if (!size) {
+		close(fd);
+		throw STORE_CORRUPT;
+	}
+
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);	// The mapping stays valid after closing
+	if (mapping == MAP_FAILED) {
+		throw STORE_MAP_FAILED;
+	}
+	madvise(mapping, size, MADV_SEQUENTIAL);
+
+	return mapping;
+}
+
+
+void StateStore::unmap(const void* mapping, const size_t& size) {
+	munmap((void*)mapping, size);
+}
+
+
+/*
+ * Sizes the log file to hold capacity records and maps it, replacing any previous mapping
+ */
+void StateStore::mapLog(const size_t& capacity) {
+	if (log_header) {
+		munmap(log_header, sizeof(StoreHeader) + log_capacity*sizeof(LogRecord));
+		log_header = nullptr;
+	}
+
+	size_t size = sizeof(StoreHeader) + capacity*sizeof(LogRecord);
+	if (posix_fallocate(log_fd, 0, size)) {	// Allocated now, as a write to a sparse mapping on a full disk raises SIGBUS
+		throw STORE_WRITE_FAILED;
+	}
+
+	void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, log_fd, 0);
+	if (mapping == MAP_FAILED) {
+		throw STORE_MAP_FAILED;
+	}
+
+	log_capacity = capacity;
+	log_header = (StoreHeader*)mapping;
+	log_records = (LogRecord*)(log_header+1);
+}
+
+
+void StateStore::append(const LogRecord& record) {
+	if (log_header->count == log_capacity) {
+		mapLog(log_capacity + STORE_LOG_GROWTH);
+	}
+
+	log_records[log_header->count] = record;
+	log_header->count++;	// Count after the record so a partially written record is never replayed
+}
+
+
+void StateStore::startSnapshot(const uint64_t& num_sensors, SnapshotBuilder build) {
+	snapshot_records = log_header->count;
+	snapshot_done.store(false, std::memory_order_relaxed);
+	snapshot_thread = std::thread(&StateStore::writeSnapshot, this, num_sensors, std::move(build));
+}
+
+
+void StateStore::addSnapshotSensor(const StoredSensor& sensor, const StoredEntry* entries) {
+	if ((std::fwrite(&sensor, sizeof(sensor), 1, snapshot_file) != 1) ||
+			(std::fwrite(entries, sizeof(StoredEntry), sensor.num_entries, snapshot_file) != sensor.num_entries)) {
+		throw STORE_WRITE_FAILED;
+	}
+}
+
+
+/*
+ * Makes the new snapshot durable before it replaces the old one. Until the log is rebased it stays
+ * of the old generation: a crash before the rename replays it on the old snapshot, a crash after the
+ * rename replays only the records appended since the snapshot was started, from snapshot_records on.
+ */
+void StateStore::writeSnapshot(const uint64_t& num_sensors, SnapshotBuilder build) {
+	snapshot_file = std::fopen((snapshot_path + ".tmp").c_str(), "wb");
+	bool failed = !snapshot_file;
+	if (snapshot_file) {
+		try {
+			StoreHeader header {STORE_SNAPSHOT_MAGIC, snapshot_generation+1, num_sensors, snapshot_records};
+			if (std::fwrite(&header, sizeof(header), 1, snapshot_file) != 1) {
+				throw STORE_WRITE_FAILED;
+			}
+			build(*this);
+		} catch (StoreError&) {
+			failed = true;
+		}
+
+		failed |= std::fflush(snapshot_file);
+		failed |= fsync(fileno(snapshot_file));
+		failed |= std::fclose(snapshot_file);
+		snapshot_file = nullptr;
+	}
+	failed = failed || std::rename((snapshot_path + ".tmp").c_str(), snapshot_path.c_str());
+	if (failed) {	// Free the space of a partial snapshot, the previous one and the log still apply
+		std::remove((snapshot_path + ".tmp").c_str());
+	}
+
+	snapshot_failed = failed;
+	snapshot_done.store(true, std::memory_order_release);
+}
+
+
+bool StateStore::collectSnapshot(const bool& wait) {
+	if (!snapshot_thread.joinable() || (!wait && !snapshot_done.load(std::memory_order_acquire))) {
+		return false;
+	}
+
+	snapshot_thread.join();
+	if (snapshot_failed) {
+		throw STORE_WRITE_FAILED;
+	}
+	snapshot_generation++;
+	rebaseLog(snapshot_records);
+
+	return true;
+}
+
+
+/*
+ * Starts a log of the snapshot's generation holding the records from first on, those appended since the
+ * snapshot was started. The count is cleared first and the generation set before the count, so a crash
+ * part way through never replays records the snapshot already holds.
+ */
+void StateStore::rebaseLog(const uint64_t& first) {
+	uint64_t tail = log_header->count - first;
+	log_header->count = 0;
+	std::memmove(log_records, log_records + first, tail*sizeof(LogRecord));
+
+	log_header->generation = snapshot_generation;
+	log_header->count = tail;
+	msync(log_header, sizeof(StoreHeader), MS_SYNC);
+}
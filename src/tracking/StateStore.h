@@ -0,0 +1,161 @@
+#ifndef SRC_STATESTORE_H_
+#define SRC_STATESTORE_H_
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+
+#define STORE_LOG_FILE "sensors.log"
+#define STORE_SNAPSHOT_FILE "sensors.snap"
+#define STORE_LOG_MAGIC 0x31474F4C35343353ull	// "S345LOG1"
+#define STORE_SNAPSHOT_MAGIC 0x31504E5335343353ull	// "S345SNP1"
+#define STORE_LOG_GROWTH 65536	// Records added to the log file each time it fills up
+#define STORE_COMPACT_RECORDS (1<<20)	// Log records after which the tracker writes a new snapshot
+
+
+enum StoreError {STORE_OPEN_FAILED, STORE_MAP_FAILED, STORE_WRITE_FAILED, STORE_CORRUPT};
+
+
+/*
+ * On-disk records, native (little-endian) byte order
+ */
+struct LogRecord {	// One message accepted by the tracker
+	uint64_t txid;
+	int64_t time;
+	uint8_t vendor;
+	uint8_t sensor_state;
+	uint8_t repeat;	// Only confirms the sensor with a repeat of its message, without being a message of its own
+	uint8_t reserved[5];
+};
+
+struct StoredSensor {	// Snapshot of one sensor, followed by num_entries StoredEntries
+	uint64_t txid;
+	int64_t last_seen;
+	uint32_t rx_msg_count;
+	uint32_t dropped_entries;
+	uint32_t num_entries;
+	uint8_t vendor;
+	uint8_t confirmed;	// A repeat of its message was received
+	uint8_t reserved[2];
+};
+
+struct StoredEntry {	// One retained state history entry
+	int64_t time;
+	uint8_t sensor_state;
+	uint8_t reserved[7];
+};
+
+struct StoreHeader {	// Leads both the log and snapshot files
+	uint64_t magic;
+	uint64_t generation;	// Incremented by each snapshot, the log only applies on top of the snapshot of the same generation
+	uint64_t count;	// Log records or snapshot sensors
+	uint64_t snapshot_records;	// Snapshot only, records of the previous generation's log it includes
+};
+
+
+/*
+ * Persists tracker state as a snapshot of all sensors plus an append-only, memory-mapped log
+ * of the messages accepted since that snapshot. Restarting maps the snapshot and replays only
+ * the log tail. Appends only touch mapped memory, the kernel writes the pages back. Snapshots are
+ * built and written on a background thread, from a copy of the state, while the log keeps taking appends.
+ */
+class StateStore {
+public:
+	StateStore(const std::string& directory);
+	~StateStore();
+	template <typename FUNC>
+	void loadSnapshot(FUNC func);	// Calls func(const StoredSensor&, const StoredEntry* entries) for each sensor
+	template <typename FUNC>
+	void replayLog(FUNC func);	// Calls func(const LogRecord&) for each record logged after the snapshot
+	void append(const LogRecord& record);
+	bool needsCompaction() const {return !snapshotPending() && (log_header->count >= STORE_COMPACT_RECORDS);};
+	using SnapshotBuilder = std::function<void(StateStore&)>;
+	void startSnapshot(const uint64_t& num_sensors, SnapshotBuilder build);	// Calls build(*this) on a background thread
+	void addSnapshotSensor(const StoredSensor& sensor, const StoredEntry* entries);	// From the SnapshotBuilder only
+	bool snapshotPending() const {return snapshot_thread.joinable();};	// Started and not yet collected
+	bool collectSnapshot(const bool& wait);	// Once written, replaces the log with its tail appended since the start, true if collected
+private:
+	void writeSnapshot(const uint64_t& num_sensors, SnapshotBuilder build);	// Background thread
+	void rebaseLog(const uint64_t& first);
+	static const void* mapReadOnly(const std::string& path, size_t& size);
+	static void unmap(const void* mapping, const size_t& size);
+	void mapLog(const size_t& capacity);
+	const std::string log_path;
+	const std::string snapshot_path;
+	int log_fd {-1};
+	size_t log_capacity {0};	// Records that fit in the mapped log file
+	StoreHeader* log_header {nullptr};	// Start of the mapped log file
+	LogRecord* log_records {nullptr};
+	uint64_t snapshot_generation {0};
+	uint64_t snapshot_base {0};	// Records of the previous generation's log the loaded snapshot includes
+	std::FILE* snapshot_file {nullptr};	// Snapshot being written, background thread only
+	uint64_t snapshot_records {0};	// Log records the snapshot being written includes
+	bool snapshot_failed {false};	// Set by the background thread before snapshot_done
+	std::atomic<bool> snapshot_done {false};
+	std::thread snapshot_thread;
+};
+
+
+template <typename FUNC>
+void StateStore::loadSnapshot(FUNC func) {
+	size_t size;
+	const void* mapping = mapReadOnly(snapshot_path, size);
+	if (!mapping) {	// No snapshot yet
+		return;
+	}
+	const unsigned char* data = (const unsigned char*)mapping;
+
+	const StoreHeader* header = (const StoreHeader*)data;
+	if ((size < sizeof(StoreHeader)) || (header->magic != STORE_SNAPSHOT_MAGIC)) {
+		unmap(mapping, size);
+		throw STORE_CORRUPT;
+	}
+	snapshot_generation = header->generation;
+	snapshot_base = header->snapshot_records;
+
+	size_t offset = sizeof(StoreHeader);
+	for (uint64_t i = 0; i < header->count; i++) {
+		const StoredSensor* sensor = (const StoredSensor*)(data+offset);
+		if ((offset+sizeof(StoredSensor) > size) ||
+				(offset+sizeof(StoredSensor)+sensor->num_entries*sizeof(StoredEntry) > size) || !sensor->num_entries) {
+			unmap(mapping, size);
+			throw STORE_CORRUPT;
+		}
+
+		func(*sensor, (const StoredEntry*)(data+offset+sizeof(StoredSensor)));
+		offset += sizeof(StoredSensor) + sensor->num_entries*sizeof(StoredEntry);
+	}
+
+	unmap(mapping, size);
+}
+
+
+/*
+ * A log one generation behind the snapshot was not rebased before a crash, the snapshot holds its
+ * first snapshot_base records and the rest are replayed. An older log is already in the snapshot.
+ */
+template <typename FUNC>
+void StateStore::replayLog(FUNC func) {
+	uint64_t first = 0;
+	if (log_header->generation+1 == snapshot_generation) {
+		first = std::min(snapshot_base, log_header->count);	// The count is cleared first while rebasing
+	} else if (log_header->generation != snapshot_generation) {
+		first = log_header->count;
+	}
+
+	for (uint64_t i = first; i < log_header->count; i++) {
+		func(log_records[i]);
+	}
+
+	if (log_header->generation != snapshot_generation) {
+		rebaseLog(first);
+	}
+}
+
+
+#endif /* SRC_STATESTORE_H_ */
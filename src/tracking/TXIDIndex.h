@@ -0,0 +1,183 @@
+#ifndef SRC_TXIDINDEX_H_
+#define SRC_TXIDINDEX_H_
+
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#define TXID_INDEX_MIN_CAPACITY 64
+#define TXID_INDEX_MAX_LOAD 0.7	// Fraction of slots in use before the index grows
+
+
+/*
+ * Open-addressing hash index keyed on TXID, using linear probing and backward-shift deletion.
+ * Keys are stored apart from values so probing only touches a dense array of TXIDs.
+ * TXID 0 is never valid (rejected by SensorMessageReceiver) and marks an empty slot.
+ */
+template <typename T>
+class TXIDIndex {
+public:
+	TXIDIndex(const size_t& expected_size = TXID_INDEX_MIN_CAPACITY);
+	T* find(const unsigned long int& txid);
+	template <typename... ARGS>
+	T& emplace(const unsigned long int& txid, ARGS&&... args);	// TXID must not already be in the index
+	bool erase(const unsigned long int& txid);
+	template <typename FUNC>
+	void forEach(FUNC func);	// Calls func(txid, value) for each entry, in no particular order
+	std::vector<unsigned long int> keys() const;
+	size_t size() const {return count;};
+	size_t capacity() const {return mask+1;};
+	void reserve(const size_t& expected_size);
+private:
+	size_t home(const unsigned long int& txid) const {return (txid * 0x9E3779B97F4A7C15ull) >> shift;};	// Fibonacci hashing
+	size_t locate(const unsigned long int& txid) const;
+	void rehash(const size_t& new_capacity);
+	std::unique_ptr<unsigned long int[]> txids;
+	std::unique_ptr<std::optional<T>[]> values;
+	size_t mask {0};
+	unsigned int shift {64};
+	size_t count {0};
+};
+
+
+template <typename T>
+TXIDIndex<T>::TXIDIndex(const size_t& expected_size) {
+	rehash(TXID_INDEX_MIN_CAPACITY);
+	reserve(expected_size);
+}
+
+
+/*
+ * Returns the slot holding the TXID, or the empty slot that ends its probe sequence
+ */
+template <typename T>
+size_t TXIDIndex<T>::locate(const unsigned long int& txid) const {
+	size_t slot = home(txid);
+	while (txids[slot] && (txids[slot] != txid)) {
+		slot = (slot+1) & mask;
+	}
+
+	return slot;
+}
+
+
+template <typename T>
+T* TXIDIndex<T>::find(const unsigned long int& txid) {
+	size_t slot = locate(txid);
+	if (!txids[slot]) {
+		return nullptr;
+	}
+
+	return &*values[slot];
+}
+
+
+template <typename T>
+template <typename... ARGS>
+T& TXIDIndex<T>::emplace(const unsigned long int& txid, ARGS&&... args) {
+	if (count+1 > capacity()*TXID_INDEX_MAX_LOAD) {
+		rehash(capacity()*2);
+	}
+
+	size_t slot = locate(txid);
+	txids[slot] = txid;
+	values[slot].emplace(std::forward<ARGS>(args)...);
+	count++;
+
+	return *values[slot];
+}
+
+
+template <typename T>
+bool TXIDIndex<T>::erase(const unsigned long int& txid) {
+	size_t slot = locate(txid);
+	if (!txids[slot]) {
+		return false;
+	}
+
+	// Shift following entries of the probe sequence back into the hole, so no tombstones are needed
+	for (size_t next = (slot+1) & mask; txids[next]; next = (next+1) & mask) {
+		// An entry may only move back if the hole lies between its home slot and its current slot
+		if (((next - home(txids[next])) & mask) >= ((next - slot) & mask)) {
+			txids[slot] = txids[next];
+			values[slot].reset();
+			values[slot].emplace(std::move(*values[next]));
+			slot = next;
+		}
+	}
+
+	txids[slot] = 0;
+	values[slot].reset();
+	count--;
+
+	return true;
+}
+
+
+template <typename T>
+template <typename FUNC>
+void TXIDIndex<T>::forEach(FUNC func) {
+	for (size_t slot = 0; slot <= mask; slot++) {
+		if (txids[slot]) {
+			func(txids[slot], *values[slot]);
+		}
+	}
+}
+
+
+template <typename T>
+std::vector<unsigned long int> TXIDIndex<T>::keys() const {
+	std::vector<unsigned long int> index_keys;
+	index_keys.reserve(count);
+	for (size_t slot = 0; slot <= mask; slot++) {
+		if (txids[slot]) {
+			index_keys.push_back(txids[slot]);
+		}
+	}
+
+	return index_keys;
+}
+
+
+/*
+ * Grows the index ahead of time so that expected_size entries fit without rehashing
+ */
+template <typename T>
+void TXIDIndex<T>::reserve(const size_t& expected_size) {
+	size_t new_capacity = capacity();
+	while (expected_size > new_capacity*TXID_INDEX_MAX_LOAD) {
+		new_capacity *= 2;
+	}
+
+	if (new_capacity != capacity()) {
+		rehash(new_capacity);
+	}
+}
+
+
+template <typename T>
+void TXIDIndex<T>::rehash(const size_t& new_capacity) {	// new_capacity must be a power of two
+	auto old_txids = std::move(txids);
+	auto old_values = std::move(values);
+	size_t old_capacity = old_txids ? mask+1 : 0;
+
+	txids = std::make_unique<unsigned long int[]>(new_capacity);	// Zeroed, all slots empty
+	values = std::make_unique<std::optional<T>[]>(new_capacity);
+	mask = new_capacity-1;
+	shift = 64;
+	for (size_t cap = new_capacity; cap > 1; cap >>= 1) {
+		shift--;
+	}
+
+	for (size_t slot = 0; slot < old_capacity; slot++) {
+		if (old_txids[slot]) {
+			size_t new_slot = locate(old_txids[slot]);
+			txids[new_slot] = old_txids[slot];
+			values[new_slot].emplace(std::move(*old_values[slot]));
+		}
+	}
+}
+
+
+#endif /* SRC_TXIDINDEX_H_ */
@@ -0,0 +1,50 @@
+#ifndef SRC_TRACKERSNAPSHOT_H_
+#define SRC_TRACKERSNAPSHOT_H_
+
+
+#include "../messaging/FrameLayout.h"
+
+#include <ctime>
+#include <vector>
+
+#define RECENT_CHANGES 128	// State changes kept for queries of recent activity
+#define SNAPSHOT_PERIOD 1	// Minimum seconds between published snapshots
+
+
+struct SensorSnapshot {
+	unsigned long int txid;
+	time_t last_seen;
+	unsigned int rx_msg_count;
+	Vendor vendor;
+	unsigned char sensor_state;
+};
+
+struct StateChange {
+	unsigned long int txid;
+	time_t time;
+	Vendor vendor;
+	unsigned char former_state;
+	unsigned char sensor_state;
+};
+
+struct TrackerCounters {
+	unsigned long long int messages;	// Messages (events) received by the tracker
+	unsigned long long int added;	// Sensors added
+	unsigned long long int changes;	// Sensor state changes
+	unsigned long long int evicted;	// Sensors evicted
+};
+
+
+/*
+ * Immutable copy of the tracker state, published for readers on other threads
+ */
+struct TrackerSnapshot {
+	unsigned long long int generation;	// Incremented with each published snapshot
+	time_t time;	// When the snapshot was taken
+	std::vector<SensorSnapshot> sensors;	// In no particular order
+	std::vector<StateChange> recent;	// Oldest first
+	TrackerCounters counters;
+};
+
+
+#endif /* SRC_TRACKERSNAPSHOT_H_ */
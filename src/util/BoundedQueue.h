@@ -0,0 +1,131 @@
+#ifndef SRC_BOUNDEDQUEUE_H_
+#define SRC_BOUNDEDQUEUE_H_
+
+
+#include "StatCounter.h"
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+
+/*
+ * Bounded lock-free queue, safe for any number of producer and consumer threads.
+ * Each cell carries a sequence number that tells producers and consumers whether the cell
+ * is free or holds an item for the current lap around the ring (D. Vyukov's bounded queue).
+ * push() and pop() never block, they fail when the queue is full or empty.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+	BoundedQueue(const size_t& capacity);	// Rounded up to a power of two
+	bool push(const T& item);
+	bool push(T&& item);
+	bool pop(T& item);
+	size_t capacity() const {return mask+1;};
+	size_t size() const;	// Approximate when other threads are active
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T item;
+	};
+	template <typename U>
+	bool emplace(U&& item);
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos {0};	// Producers and consumers on separate cache lines
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos {0};
+	char padding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(const size_t& capacity) {
+	size_t size = 2;
+	while (size < capacity) {
+		size <<= 1;
+	}
+
+	cells = std::make_unique<Cell[]>(size);
+	mask = size-1;
+	for (size_t i = 0; i < size; i++) {
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+
+template <typename T>
+template <typename U>
+bool BoundedQueue<T>::emplace(U&& item) {
+	size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+	Cell* cell;
+	while (true) {
+		cell = &cells[pos & mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {	// Cell is free for this lap, try to claim it
+			if (enqueue_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {	// Cell still holds an item from the previous lap, queue is full
+			return false;
+		} else {	// Another producer claimed this cell, retry with the latest position
+			pos = enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->item = std::forward<U>(item);
+	cell->sequence.store(pos+1, std::memory_order_release);	// Publish the item to consumers
+
+	return true;
+}
+
+
+template <typename T>
+bool BoundedQueue<T>::push(const T& item) {
+	return emplace(item);
+}
+
+
+template <typename T>
+bool BoundedQueue<T>::push(T&& item) {
+	return emplace(std::move(item));
+}
+
+
+template <typename T>
+bool BoundedQueue<T>::pop(T& item) {
+	size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+	Cell* cell;
+	while (true) {
+		cell = &cells[pos & mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(pos+1);
+		if (diff == 0) {	// Cell holds an item for this lap, try to claim it
+			if (dequeue_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {	// Queue is empty
+			return false;
+		} else {	// Another consumer claimed this cell, retry with the latest position
+			pos = dequeue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	item = std::move(cell->item);
+	cell->sequence.store(pos+mask+1, std::memory_order_release);	// Free the cell for the next lap
+
+	return true;
+}
+
+
+template <typename T>
+size_t BoundedQueue<T>::size() const {
+	size_t enqueued = enqueue_pos.load(std::memory_order_relaxed);
+	size_t dequeued = dequeue_pos.load(std::memory_order_relaxed);
+
+	return (enqueued > dequeued) ? enqueued-dequeued : 0;
+}
+
+
+#endif /* SRC_BOUNDEDQUEUE_H_ */
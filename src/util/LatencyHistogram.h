@@ -0,0 +1,145 @@
+#ifndef SRC_LATENCYHISTOGRAM_H_
+#define SRC_LATENCYHISTOGRAM_H_
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#define LATENCY_SUB_BUCKET_BITS 5	// 32 linear sub-buckets per power of two, values are within 1/32 (3.1%)
+#define LATENCY_MAX_BITS 40	// Values up to 2^40 ns (18 minutes), larger values are clamped
+#define LATENCY_NUM_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS + 1) << LATENCY_SUB_BUCKET_BITS)
+
+
+/*
+ * Monotonic clock for latency stamps, ns. Stamps are only compared with each other.
+ */
+inline long long int latencyClock() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/*
+ * Stamps taken as a frame moves from the radio to the tracker, 0 when not taken
+ */
+struct LatencyStamps {
+	long long int acquired;	// Sample block containing the end of the frame returned by the radio
+	long long int filtered;	// Last sample of the frame left the filter chain
+	long long int decoded;	// Frame passed its CRC in the receiver
+};
+
+
+/*
+ * Fixed-size histogram of latencies with bounded relative error (HDR histogram style): each power of
+ * two range is split into equal linear sub-buckets. Recording is a single relaxed atomic increment,
+ * so any thread may record or print at any time without locks.
+ */
+class LatencyHistogram {
+public:
+	void record(const long long int& latency);	// ns, negative values are recorded as 0
+	unsigned long long int count() const {return total.load(std::memory_order_relaxed);};
+	long long int percentile(const double& percent) const;	// Upper bound of the latency of the percent-th value, ns
+	long long int max() const {return max_latency.load(std::memory_order_relaxed);};
+	void print(std::ostream& out, const char* name) const;
+private:
+	static size_t bucket(const unsigned long long int& latency);
+	static long long int bucketLimit(const size_t& bucket);	// Largest latency counted in the bucket
+	std::array<std::atomic<unsigned long long int>, LATENCY_NUM_BUCKETS> counts {};
+	std::atomic<unsigned long long int> total {0};
+	std::atomic<long long int> max_latency {0};
+};
+
+
+inline size_t LatencyHistogram::bucket(const unsigned long long int& latency) {
+	if (latency < (0x1ull<<LATENCY_SUB_BUCKET_BITS)) {	// Exact below the first sub-bucketed power of two
+		return latency;
+	}
+
+	unsigned int msb = 63 - __builtin_clzll(latency);
+	unsigned int shift = msb - LATENCY_SUB_BUCKET_BITS;
+	return ((shift+1) << LATENCY_SUB_BUCKET_BITS) + ((latency >> shift) & ((0x1ull<<LATENCY_SUB_BUCKET_BITS)-1));
+}
+
+
+inline long long int LatencyHistogram::bucketLimit(const size_t& bucket) {
+	if (bucket < (0x1ull<<LATENCY_SUB_BUCKET_BITS)) {
+		return bucket;
+	}
+
+	unsigned int shift = (bucket >> LATENCY_SUB_BUCKET_BITS) - 1;
+	unsigned long long int sub_bucket = (bucket & ((0x1ull<<LATENCY_SUB_BUCKET_BITS)-1)) | (0x1ull<<LATENCY_SUB_BUCKET_BITS);
+	return ((sub_bucket+1) << shift) - 1;
+}
+
+
+inline void LatencyHistogram::record(const long long int& latency) {
+	unsigned long long int clamped = (latency < 0) ? 0 : std::min<unsigned long long int>(latency, (0x1ull<<LATENCY_MAX_BITS)-1);
+	counts[bucket(clamped)].fetch_add(1, std::memory_order_relaxed);
+	total.fetch_add(1, std::memory_order_relaxed);
+
+	long long int previous_max = max_latency.load(std::memory_order_relaxed);
+	while (((long long int)clamped > previous_max) && !max_latency.compare_exchange_weak(previous_max, clamped, std::memory_order_relaxed));
+}
+
+
+inline long long int LatencyHistogram::percentile(const double& percent) const {
+	unsigned long long int target = count()*percent/100;
+	unsigned long long int seen = 0;
+	for (size_t i = 0; i < LATENCY_NUM_BUCKETS; i++) {
+		seen += counts[i].load(std::memory_order_relaxed);
+		if (seen > target) {
+			return std::min(bucketLimit(i), max());
+		}
+	}
+
+	return max();
+}
+
+
+inline void LatencyHistogram::print(std::ostream& out, const char* name) const {
+	out << std::left << std::setfill(' ') << std::setw(16) << name << std::right << std::setw(10) << count();
+	for (auto percent : {50.0, 90.0, 99.0, 99.9}) {
+		out << std::setw(12) << std::fixed << std::setprecision(1) << percentile(percent)/1e3;
+	}
+	out << std::setw(12) << max()/1e3 << std::defaultfloat << std::endl;
+}
+
+
+/*
+ * Latency of each stage between a sample block arriving from the radio and the tracker updating
+ */
+struct PipelineLatency {
+	LatencyHistogram dsp;	// Acquired to filtered
+	LatencyHistogram decode;	// Filtered to decoded
+	LatencyHistogram tracker;	// Decoded to tracker update, includes the hand-off from the radio thread
+	LatencyHistogram total;	// Acquired to tracker update
+
+	void record(const LatencyStamps& stamps, const long long int& updated) {
+		if (!stamps.acquired) {
+			return;
+		}
+		dsp.record(stamps.filtered - stamps.acquired);
+		decode.record(stamps.decoded - stamps.filtered);
+		tracker.record(updated - stamps.decoded);
+		total.record(updated - stamps.acquired);
+	};
+
+	void print(std::ostream& out) const {
+		out << std::endl << "## LATENCY (us) ##" << std::endl;
+		out << std::left << std::setfill(' ') << std::setw(16) << "STAGE" << std::right << std::setw(10) << "FRAMES";
+		for (auto column : {"P50", "P90", "P99", "P99.9", "MAX"}) {
+			out << std::setw(12) << column;
+		}
+		out << std::endl;
+		dsp.print(out, "ACQUIRE->DSP");
+		decode.print(out, "DSP->FRAME");
+		tracker.print(out, "FRAME->TRACKER");
+		total.print(out, "END TO END");
+	};
+};
+
+
+#endif /* SRC_LATENCYHISTOGRAM_H_ */
@@ -0,0 +1,77 @@
+#ifndef SRC_SNAPSHOTPUBLISHER_H_
+#define SRC_SNAPSHOTPUBLISHER_H_
+
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+/*
+ * Publishes immutable snapshots from one writer thread to one reader thread without locks (RCU style).
+ * The writer swaps in each new snapshot and retires the old one, freeing retired snapshots once the
+ * reader's hazard pointer no longer protects them. The reader pins the current snapshot with acquire(),
+ * which stays valid until its next acquire() or release().
+ */
+template <typename T>
+class SnapshotPublisher {
+public:
+	~SnapshotPublisher();
+	void publish(std::unique_ptr<const T> snapshot);	// Writer thread only
+	const T* acquire();	// Reader thread only, nullptr until the first publish
+	void release() {hazard.store(nullptr);};	// Reader thread only
+private:
+	void reclaim();
+	std::atomic<const T*> current {nullptr};
+	std::atomic<const T*> hazard {nullptr};	// Snapshot in use by the reader
+	std::vector<const T*> retired;	// Replaced snapshots awaiting reclamation, writer thread only
+};
+
+
+template <typename T>
+SnapshotPublisher<T>::~SnapshotPublisher() {	// Both threads must be done with the publisher
+	delete current.load();
+	for (auto snapshot : retired) {
+		delete snapshot;
+	}
+}
+
+
+template <typename T>
+void SnapshotPublisher<T>::publish(std::unique_ptr<const T> snapshot) {
+	auto old_snapshot = current.exchange(snapshot.release());
+	if (old_snapshot) {
+		retired.push_back(old_snapshot);
+	}
+
+	reclaim();
+}
+
+
+template <typename T>
+const T* SnapshotPublisher<T>::acquire() {
+	const T* snapshot;
+	do {	// Protect the snapshot, then verify it was not replaced before the protection became visible
+		snapshot = current.load();
+		hazard.store(snapshot);
+	} while (snapshot != current.load());
+
+	return snapshot;
+}
+
+
+template <typename T>
+void SnapshotPublisher<T>::reclaim() {
+	auto protected_snapshot = hazard.load();
+	for (auto snapshot = retired.begin(); snapshot != retired.end();) {
+		if (*snapshot != protected_snapshot) {
+			delete *snapshot;
+			snapshot = retired.erase(snapshot);
+		} else {
+			++snapshot;
+		}
+	}
+}
+
+
+#endif /* SRC_SNAPSHOTPUBLISHER_H_ */
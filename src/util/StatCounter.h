@@ -0,0 +1,24 @@
+#ifndef SRC_STATCOUNTER_H_
+#define SRC_STATCOUNTER_H_
+
+
+#include <atomic>
+
+#define CACHE_LINE_SIZE 64
+
+
+/*
+ * Counter written by a single thread and read by any thread, without locked instructions.
+ * Group the counters of one writer in a struct aligned to CACHE_LINE_SIZE, so writers don't
+ * share cache lines.
+ */
+class StatCounter {
+public:
+	void add(const unsigned long long int& n = 1) {value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);};
+	unsigned long long int get() const {return value.load(std::memory_order_relaxed);};
+private:
+	std::atomic<unsigned long long int> value {0};
+};
+
+
+#endif /* SRC_STATCOUNTER_H_ */
@@ -0,0 +1,140 @@
+#ifndef SRC_WORKSTEALINGPOOL_H_
+#define SRC_WORKSTEALINGPOOL_H_
+
+
+#include "StatCounter.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/*
+ * Runs tasks on a fixed set of worker threads, each with its own task queue. Workers take their newest
+ * task first and, once their own queue is empty, steal the oldest task of another worker, so uneven
+ * task lengths are balanced without a shared queue. Queues are locked, which costs nothing noticeable
+ * for coarse tasks such as whole files.
+ */
+class WorkStealingPool {
+public:
+	WorkStealingPool(const unsigned int& num_threads = std::thread::hardware_concurrency());
+	~WorkStealingPool();	// Runs all submitted tasks first
+	void submit(std::function<void()> task);	// Spread over the workers round-robin
+	void wait();	// Until all submitted tasks have run
+	unsigned int size() const {return workers.size();};
+private:
+	struct alignas(CACHE_LINE_SIZE) TaskQueue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+	bool take(const unsigned int& worker, std::function<void()>& task);
+	void run(const unsigned int& worker);
+	std::unique_ptr<TaskQueue[]> queues;
+	std::vector<std::thread> workers;
+	unsigned int next_queue {0};
+	std::mutex state_mutex;	// Guards the counts and stopping for the condition variables
+	std::condition_variable work_available;
+	std::condition_variable work_done;
+	size_t pending {0};	// Tasks submitted and not yet finished
+	size_t queued {0};	// Tasks submitted and not yet reserved by a worker
+	bool stopping {false};
+};
+
+
+inline WorkStealingPool::WorkStealingPool(const unsigned int& num_threads) :
+		queues(std::make_unique<TaskQueue[]>(num_threads ? num_threads : 1)) {
+	for (unsigned int i = 0; i < (num_threads ? num_threads : 1); i++) {
+		workers.emplace_back(&WorkStealingPool::run, this, i);
+	}
+}
+
+
+inline WorkStealingPool::~WorkStealingPool() {
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		stopping = true;
+	}
+	work_available.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+
+inline void WorkStealingPool::submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(queues[next_queue].mutex);
+		queues[next_queue].tasks.push_back(std::move(task));
+	}
+	next_queue = (next_queue+1) % workers.size();
+
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		pending++;
+		queued++;
+	}
+	work_available.notify_one();
+}
+
+
+inline void WorkStealingPool::wait() {
+	std::unique_lock<std::mutex> lock(state_mutex);
+	work_done.wait(lock, [this] {return !pending;});
+}
+
+
+/*
+ * Takes the newest task of the worker's own queue, or else the oldest task of the next worker that has one
+ */
+inline bool WorkStealingPool::take(const unsigned int& worker, std::function<void()>& task) {
+	for (unsigned int i = 0; i < workers.size(); i++) {
+		auto& queue = queues[(worker+i) % workers.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			if (!i) {
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			} else {
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+inline void WorkStealingPool::run(const unsigned int& worker) {
+	std::function<void()> task;
+	while (true) {
+		{	// Reserve one of the queued tasks, so taking one below cannot fail
+			std::unique_lock<std::mutex> lock(state_mutex);
+			work_available.wait(lock, [this] {return queued || stopping;});
+			if (!queued) {
+				return;
+			}
+			queued--;
+		}
+
+		while (!take(worker, task));
+		task();
+		task = nullptr;	// Release what the task holds before reporting it done
+
+		std::lock_guard<std::mutex> lock(state_mutex);
+		if (!--pending) {
+			work_done.notify_all();
+		}
+	}
+}
+
+
+#endif /* SRC_WORKSTEALINGPOOL_H_ */